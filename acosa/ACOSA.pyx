@@ -25,6 +25,7 @@ import cython
 cimport numpy as np
 from libcpp cimport bool
 from libcpp.vector cimport vector
+from libcpp.utility cimport move
 from cython.operator cimport dereference, preincrement
 np.import_array()
 
@@ -48,6 +49,45 @@ cdef extern from "basic_types.hpp" namespace "ACOSA":
 		size_t j
 
 # The Voronoi-/Delaunay-tesselation class:
+cdef extern from "vdtesselation.hpp" namespace "ACOSA::VDTesselation":
+	cdef enum delaunay_algorithm_t:
+		FORTUNES
+		BRUTE_FORCE
+		INCREMENTAL_HULL
+		DIVIDE_AND_CONQUER
+
+	# The check bits, static members of VDTesselation. Cython cannot
+	# access static data members through the class, so they are
+	# declared in its scope:
+	const int CHECK_NOTHING
+	const int CHECK_DUAL_LINKS
+	const int CHECK_VORONOI_CELL_AREAS
+	const int CHECK_TOPOLOGY
+
+	cdef struct statistics_t:
+		double time_triangulation
+		double time_checks
+		double time_delaunay_links
+		double time_voronoi_nodes
+		double time_merge_clusters
+		double time_voronoi_network
+		double time_dual_links
+		size_t peak_beach_size
+		size_t circle_events_pushed
+		size_t circle_events_invalidated
+		size_t circle_events_processed
+		bool fallback
+		size_t bytes_nodes
+		size_t bytes_delaunay_triangles
+		size_t bytes_delaunay_links
+		size_t bytes_voronoi_nodes
+		size_t bytes_voronoi_links
+		size_t bytes_voronoi_areas
+		size_t bytes_cluster_maps
+		size_t bytes_dual_links
+		size_t bytes_half_edges
+		size_t bytes_node_triangles
+
 cdef extern from "vdtesselation.hpp" namespace "ACOSA":
 	cdef cppclass VDTesselation :
 		const size_t N
@@ -55,16 +95,36 @@ cdef extern from "vdtesselation.hpp" namespace "ACOSA":
 		size_t size() const
 		
 		VDTesselation(const vector[Node]& nodes, double tolerance) except +
+
+		# Declared by value, since Cython does not support rvalue
+		# references. Called with move(nodes), the C++ overload taking
+		# std::vector<Node>&& is chosen:
+		VDTesselation(vector[Node] nodes, double tolerance,
+		              delaunay_algorithm_t algorithm, int checks,
+		              bool on_error_display_nodes, unsigned int num_threads,
+		              bool merge_duplicates) except +
+
+		const vector[size_t]& merged_nodes() const
+
+		statistics_t statistics() const
 		
 		void delaunay_triangulation(vector[Link]& links) const
 		
+		const vector[Link]& delaunay_links() const
+		
 		const vector[Triangle]& delaunay_triangles() const
 		
 		void voronoi_tesselation(vector[Node]& voronoi_nodes,
 		                         vector[Link]& voronoi_links) const
 		
+		const vector[Node]& voronoi_nodes() const
+		
+		const vector[Link]& voronoi_links() const
+		
 		void voronoi_cell_areas(vector[double]& areas) const
 		
+		const vector[double]& voronoi_cell_areas() const
+		
 		void associated_nodes(const vector[size_t]& voronoi_nodes,
 			vector[size_t]& associated) const;
 
@@ -135,7 +195,7 @@ cdef class VoronoiDelaunayTesselation:
 	cdef VDTesselation* tesselation
 
 	# Constructor:
-	def __cinit__(self, lon, lat, tolerance = 1e-10):
+	def __cinit__(self, lon, lat, tolerance = 1e-10, merge_duplicates = False):
 		"""
 		Initialize a VoronoiDelaunayTesselation instance, running the
 		sweepline algorithm and creating data structures for both the
@@ -152,6 +212,11 @@ cdef class VoronoiDelaunayTesselation:
 		               this parameter may sometimes solve problems
 		               in numerical instable configurations.
 		               (Default: 1e-10)
+		   merge_duplicates : If True, nodes that are equal within
+		               tolerance are merged instead of raising an
+		               error. The node indices of all results then
+		               refer to the merged nodes, see merged_nodes().
+		               (Default: False)
 
 		The input coordinates need to be convertible to numpy arrays
 		and are flattened before executing the algorithm. The flattened
@@ -181,9 +246,13 @@ cdef class VoronoiDelaunayTesselation:
 			nodes[i].lon = lon_fix[i]
 			nodes[i].lat = lat_fix[i]
 
-		# Create VDTesselation object:
+		# Create VDTesselation object, handing over the nodes, with the
+		# default checks.
 		# TODO put this into a smart pointer.
-		self.tesselation = new VDTesselation(nodes,_tolerance)
+		cdef bool _merge_duplicates = merge_duplicates
+		self.tesselation = new VDTesselation(move(nodes), _tolerance, FORTUNES,
+		                                     CHECK_TOPOLOGY, True, 0,
+		                                     _merge_duplicates)
 
 		if not self.tesselation:
 			raise Exception("VoronoiDelaunayTesselation() :\nCould not allocate "
@@ -194,6 +263,64 @@ cdef class VoronoiDelaunayTesselation:
 		if self.tesselation:
 			del self.tesselation
 
+	# Map of input nodes to merged nodes:
+	def merged_nodes(self):
+		"""
+		Return the index of the merged node for each input node.
+
+		Returns None if the instance was created without
+		merge_duplicates. Otherwise, returns an array with one entry
+		per input node, the index of the node it has been merged into.
+		Merged nodes are ordered by their first occurrence in the
+		input, and all node indices of the other methods refer to them.
+		"""
+		# Sanity check:
+		if not self.tesselation:
+			raise Exception("VoronoiDelaunayTesselation.merged_nodes() : "
+			                "Tesselation not initialized!")
+
+		cdef const vector[size_t]* merged = \
+		    &dereference(self.tesselation).merged_nodes()
+		if merged.empty():
+			return None
+
+		cdef np.ndarray[long, ndim=1] out = np.zeros(merged.size(),
+		                                             dtype=int)
+		cdef size_t i
+		for i in range(merged.size()):
+			out[i] = dereference(merged)[i]
+
+		return out
+
+	# Statistics:
+	def statistics(self):
+		"""
+		Return the statistics of the computations done so far.
+
+		Returns a dictionary with the wall times (in seconds) of the
+		phases of the computation ('time_triangulation', 'time_checks',
+		'time_delaunay_links', 'time_voronoi_nodes',
+		'time_merge_clusters', 'time_voronoi_network',
+		'time_dual_links'), the sweep statistics ('peak_beach_size',
+		'circle_events_pushed', 'circle_events_invalidated',
+		'circle_events_processed'), whether the sweep failed so that
+		the incremental hull algorithm was used instead ('fallback',
+		only if requested by the C++ RETRY_INCREMENTAL_HULL flag),
+		and the bytes currently held by
+		each cache ('bytes_nodes', 'bytes_delaunay_triangles',
+		'bytes_delaunay_links', 'bytes_voronoi_nodes',
+		'bytes_voronoi_links', 'bytes_voronoi_areas',
+		'bytes_cluster_maps', 'bytes_dual_links', 'bytes_half_edges',
+		'bytes_node_triangles').
+		"""
+		# Sanity check:
+		if not self.tesselation:
+			raise Exception("VoronoiDelaunayTesselation.statistics() : "
+			                "Tesselation not initialized!")
+
+		# The struct converts to a dictionary:
+		return dereference(self.tesselation).statistics()
+
 	# Voronoi cell areas:
 	def voronoi_cell_areas(self):
 		# Sanity check:
@@ -201,9 +328,9 @@ cdef class VoronoiDelaunayTesselation:
 			raise Exception("VoronoiDelaunayTesselation() :\nVDTesselation "
 				"was not initialized!\n")
 
-		# Obtain vector of areas:
-		cdef vector[double] areas
-		dereference(self.tesselation).voronoi_cell_areas(areas)
+		# Obtain vector of areas without copying:
+		cdef const vector[double]* areas = \
+		    &dereference(self.tesselation).voronoi_cell_areas()
 
 		# Copy to numpy array:
 		cdef np.ndarray[float, ndim=1] np_areas = np.zeros(areas.size(), 
@@ -211,7 +338,7 @@ cdef class VoronoiDelaunayTesselation:
 
 		cdef size_t i
 		for i in range(areas.size()):
-			np_areas[i] = areas[i]
+			np_areas[i] = dereference(areas)[i]
 
 		# Return numpy array:
 		return np_areas
@@ -239,10 +366,11 @@ cdef class VoronoiDelaunayTesselation:
 			raise Exception("VoronoiDelaunayTesselation() :\nVDTesselation "
 				"was not initialized!\n")
 
-		# Obtain vectors of nodes and links:
-		cdef vector[Node] nodes
-		cdef vector[Link] links
-		dereference(self.tesselation).voronoi_tesselation(nodes, links)
+		# Obtain vectors of nodes and links without copying:
+		cdef const vector[Node]* nodes = \
+		    &dereference(self.tesselation).voronoi_nodes()
+		cdef const vector[Link]* links = \
+		    &dereference(self.tesselation).voronoi_links()
 
 		# Copy to numpy arrays:
 		cdef np.ndarray[long, ndim=2] np_links = np.zeros((links.size(),2), 
@@ -255,12 +383,12 @@ cdef class VoronoiDelaunayTesselation:
 		cdef size_t i
 		cdef double r2d = 180.0/np.pi
 		for i in range(nodes.size()):
-			lon[i] = r2d*nodes[i].lon
-			lat[i] = r2d*nodes[i].lat
+			lon[i] = r2d*dereference(nodes)[i].lon
+			lat[i] = r2d*dereference(nodes)[i].lat
 
 		for i in range(links.size()):
-			np_links[i,0] = links[i].i
-			np_links[i,1] = links[i].j
+			np_links[i,0] = dereference(links)[i].i
+			np_links[i,1] = dereference(links)[i].j
 
 		# Return numpy arrays:
 		return lon, lat, np_links
@@ -284,9 +412,9 @@ cdef class VoronoiDelaunayTesselation:
 			raise Exception("VoronoiDelaunayTesselation() :\nVDTesselation "
 				"was not initialized!\n")
 
-		# Obtain vector of links:
-		cdef vector[Link] links
-		dereference(self.tesselation).delaunay_triangulation(links)
+		# Obtain vector of links without copying:
+		cdef const vector[Link]* links = \
+		    &dereference(self.tesselation).delaunay_links()
 
 		# Copy to numpy array:
 		cdef np.ndarray[long, ndim=2] np_links = np.zeros((links.size(),2), 
@@ -294,8 +422,8 @@ cdef class VoronoiDelaunayTesselation:
 
 		cdef size_t i
 		for i in range(links.size()):
-			np_links[i,0] = links[i].i
-			np_links[i,1] = links[i].j
+			np_links[i,0] = dereference(links)[i].i
+			np_links[i,1] = dereference(links)[i].j
 
 		# Return numpy arrays:
 		return np_links
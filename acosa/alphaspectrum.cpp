@@ -50,22 +50,18 @@ AlphaSpectrum::AlphaSpectrum(const std::vector<ACOSA::Node>& nodes,
 	tesselation.calculate_dual_links();
 
 
-	/* Step 2: Create a map from node indices to associated Voronoi cells.
+	/* Step 2: Obtain the map from node indices to associated Voronoi
+	 *         cells from the tesselation.
 	 *         The map may contain duplicates as some Delaunay triangles
 	 *         may have been merged to the same Voronoi node, but that
 	 *         should not make a big performance difference in most cases,
 	 *         alas we do not check for duplicates. */
-	std::vector<std::forward_list<size_t>> node2delaunay(N);
-	for (size_t i=0; i<tesselation.delaunay_triangles_.size(); ++i){
-		const Triangle& t = tesselation.delaunay_triangles_[i];
-		node2delaunay[t.i].push_front(i);
-		node2delaunay[t.j].push_front(i);
-		node2delaunay[t.k].push_front(i);
-	}
+	tesselation.calculate_node_triangles();
+	const CSRIncidence& node2delaunay = tesselation.node2delaunay;
 
 
-	alpha_intervals.resize(tesselation.delaunay_links.size());
-	delaunay_links = tesselation.delaunay_links;
+	alpha_intervals.resize(tesselation.delaunay_links_.size());
+	delaunay_links = tesselation.delaunay_links_;
 
 
 	/* Step 3: For each node, calculate the maximum alpha where it is
@@ -88,7 +84,7 @@ AlphaSpectrum::AlphaSpectrum(const std::vector<ACOSA::Node>& nodes,
 		ACOSA::SphereVector vec(nodes[i].lon, nodes[i].lat);
 		double max_dist = 0.0;
 		for (size_t j : node2delaunay[i]){
-			const Node& n2 = tesselation.voronoi_nodes[tesselation
+			const Node& n2 = tesselation.voronoi_nodes_[tesselation
 			                    .delaunay2voronoi[j]];
 			double d = vec.distance(ACOSA::SphereVector(n2.lon, n2.lat));
 			if (d > max_dist)
@@ -101,7 +97,7 @@ AlphaSpectrum::AlphaSpectrum(const std::vector<ACOSA::Node>& nodes,
 	/* Step 5: For each link of the Delaunay-tesselation, calculate the alpha
 	 *         bounds inside which it is part of the alpha shape of the point
 	 *         set: */
-	for (size_t i=0; i<tesselation.delaunay_links.size(); ++i){
+	for (size_t i=0; i<tesselation.delaunay_links_.size(); ++i){
 		/* Obtain the id (in terms of Voronoi link array) of the i'th Delaunay
 		 * tesselation link. In cases where there are more than 3 cocircular
 		 * points, the Delaunay tesselation is not unique and, more importantly,
@@ -116,8 +112,8 @@ AlphaSpectrum::AlphaSpectrum(const std::vector<ACOSA::Node>& nodes,
 
 		/* If we have a dual link, obtain both the Delaunay and the dual Voronoi
 		 * link: */
-		ACOSA::Link dl = tesselation.delaunay_links[i];
-		ACOSA::Link vl = tesselation.voronoi_links[dual_link];
+		ACOSA::Link dl = tesselation.delaunay_links_[i];
+		ACOSA::Link vl = tesselation.voronoi_links_[dual_link];
 
 		/* Case a) in [2], Lemma 3:
 		 *		alpha \in [alpha_min, alpha_max]
@@ -138,10 +134,10 @@ AlphaSpectrum::AlphaSpectrum(const std::vector<ACOSA::Node>& nodes,
 		 * We can thus calculate a and b. */
 		ACOSA::SphereVector n1(nodes[dl.i].lon, nodes[dl.i].lat);
 		ACOSA::SphereVector n2(nodes[dl.j].lon, nodes[dl.j].lat);
-		ACOSA::SphereVector vn1(tesselation.voronoi_nodes[vl.i].lon,
-		                        tesselation.voronoi_nodes[vl.i].lat);
-		ACOSA::SphereVector vn2(tesselation.voronoi_nodes[vl.j].lon,
-		                        tesselation.voronoi_nodes[vl.j].lat);
+		ACOSA::SphereVector vn1(tesselation.voronoi_nodes_[vl.i].lon,
+		                        tesselation.voronoi_nodes_[vl.i].lat);
+		ACOSA::SphereVector vn2(tesselation.voronoi_nodes_[vl.j].lon,
+		                        tesselation.voronoi_nodes_[vl.j].lat);
 
 		/* Calculating b is straightforward: */
 		double d_n1_v1 = n1.distance(vn1);
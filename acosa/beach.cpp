@@ -25,6 +25,7 @@
 
 #include <beach.hpp>
 #include <circleevent.hpp>
+#include <predicates.hpp>
 
 #include <cmath>
 #include <iostream>
@@ -33,19 +34,63 @@
 
 namespace ACOSA {
 
+/* Band around an arc border within which its floating point position
+ * cannot decide the side of a site, in units of pseudo_angle and of
+ * longitude: */
+static constexpr double BORDER_BAND = 1e-9;
+
+/* Bound of the error of a border's direction in units of the rounding
+ * errors of its equation's coefficients: */
+static constexpr double BORDER_ERROR
+    = 32.0 * std::numeric_limits<double>::epsilon();
+
+//----------------------------------------------------------------------
+static void unit_vector(double lon, double lat, double p[3])
+{
+	/* Same evaluation as in ArcIntersect: */
+	double clat = std::cos(lat);
+	p[0] = clat * std::cos(lon);
+	p[1] = clat * std::sin(lon);
+	p[2] = std::sin(lat);
+}
+
+
 /* ****************************************************************** */
-/*                        class ArcIntersect                          */
+/*                            struct Tide                             */
 /* ****************************************************************** */
-ArcIntersect::ArcIntersect()
+Tide::Tide(double lat) : lat(lat), sin(std::sin(lat)), cos(std::cos(lat))
 {
 }
 
-ArcIntersect::ArcIntersect(const OrderParameter& position, size_t id,
-	const SphereVector& vec, const SphereVector& left)
-	: vec_(vec), id_(id), left_(left), pos(position)
+
+
+/* ****************************************************************** */
+/*                        class ArcIntersect                          */
+/* ****************************************************************** */
+ArcIntersect::ArcIntersect(size_t id, const SphereVector& vec,
+	const SphereVector& left)
+	: id_(id), vec_(vec)
 {
+	/* Precompute the Euclidean coordinates of the arc's site: */
+	double clat = std::cos(vec_.lat());
+	clon1 = std::cos(vec_.lon());
+	slon1 = std::sin(vec_.lon());
+	x1 = clat * clon1;
+	y1 = clat * slon1;
+	z1 = std::sin(vec_.lat());
+
+	set_left(left);
 }
 
+//----------------------------------------------------------------------
+void ArcIntersect::set_left(const SphereVector& left)
+{
+	left_ = left;
+	double clat = std::cos(left_.lat());
+	x2 = clat * std::cos(left_.lon());
+	y2 = clat * std::sin(left_.lon());
+	z2 = std::sin(left_.lat());
+}
 
 //----------------------------------------------------------------------
 size_t ArcIntersect::id() const
@@ -68,77 +113,150 @@ const SphereVector& ArcIntersect::left() const
 //----------------------------------------------------------------------	
 
 //----------------------------------------------------------------------
-static double asin_bounded(double s){
-	if (s > 1.0){
-		return 0.5*M_PI;
-	} else if (s < -1.0){
-		return -0.5*M_PI;
-	}
-	return std::asin(s);
+bool ArcIntersect::at_tide(const Tide& tide) const
+{
+	/* Whether the arc's site lies at the tide, i.e. its arc is a
+	 * meridian. Sites whose latitudes differ by less than the precision
+	 * of their Euclidean coordinates are treated as equal, so that this
+	 * agrees with left_border_side: */
+	return tide.lat <= vec_.lat() || (tide.sin <= z1 && tide.lat <= M_PI_2);
 }
 
 //----------------------------------------------------------------------
-static double acos_bounded(double c){
-	if (c > 1.0){
-		return 0.0;
-	} else if (c < -1.0){
-		return M_PI;
-	}
-	return std::acos(c);
+bool ArcIntersect::left_at_tide(const Tide& tide) const
+{
+	/* As at_tide for the site of the left neighbour: */
+	return tide.lat <= left_.lat() || (tide.sin <= z2 && tide.lat <= M_PI_2);
 }
 
 //----------------------------------------------------------------------
-double ArcIntersect::lon_left(double tide, double anchor, bool correct)
-    const
-{	
+void ArcIntersect::left_direction(const Tide& tide, double& c, double& s,
+    bool correct) const
+{
 	/* Sanity check (this is most important for regular lattices where
 	 * many nodes of equal latitude exist): */
-	if (tide <= vec_.lat() && correct){
-		double ll = vec_.lon()-anchor;
-		if (ll <= 0.0){
-			ll += 2.0*M_PI;
+	if (at_tide(tide) && correct){
+		c = clon1;
+		s = slon1;
+		return;
+	}
+
+	double error;
+	left_direction(tide, c, s, error);
+}
+
+//----------------------------------------------------------------------
+void ArcIntersect::left_direction(const Tide& tide, double& c, double& s,
+    double& error, double* bound) const
+{
+	if (at_tide(tide)){
+		c = clon1;
+		s = slon1;
+		error = 0.0;
+		if (bound){
+			*bound = 0.0;
+		}
+		return;
+	}
+	if (left_at_tide(tide) && (x2 != 0.0 || y2 != 0.0)){
+		/* The arc of the left neighbour is a meridian, which meets this
+		 * arc at the neighbour's longitude. The solution below
+		 * degenerates to psi = -pi/2 there, where cos(psi) keeps only
+		 * half of the digits: */
+		double inv_norm = 1.0 / std::sqrt(x2*x2 + y2*y2);
+		c = x2 * inv_norm;
+		s = y2 * inv_norm;
+		error = 0.0;
+		if (bound){
+			*bound = 0.0;
 		}
-		return ll;
+		return;
 	}
 
-	/* Calculation following [1].*/
-	double stide = std::sin(tide);
-	double clat1 = std::cos(vec_.lat());
-	double slat1 = std::sin(vec_.lat());
-	double clat2 = std::cos(left_.lat());
-	double slat2 = std::sin(left_.lat());
-	double lon1 = vec_.lon();
-	double lon2 = left_.lon();
-	
-	/* We have theta = pi/2-lat, so
-	 *    cos(theta) --> sin(lat)   ;    sin(theta) --> cos(lat) */
-	double e = (slat1 - slat2) * std::cos(tide);
-	double a =   (stide - slat2) * clat1 * std::cos(lon1)
-	           - (stide - slat1) * clat2 * std::cos(lon2);
-	double b =   (stide - slat2) * clat1 * std::sin(lon1)
-	           - (stide - slat1) * clat2 * std::sin(lon2);
-	
+	/* Calculation following [1]. The border longitude lon solves
+	 *    a*cos(lon) + b*sin(lon) = e
+	 * We have theta = pi/2-lat, so
+	 *    cos(theta) --> sin(lat) = z   ;    sin(theta) --> cos(lat) */
+	double e = (z1 - z2) * tide.cos;
+	double ax1 = (tide.sin - z2) * x1, ax2 = (tide.sin - z1) * x2;
+	double by1 = (tide.sin - z2) * y1, by2 = (tide.sin - z1) * y2;
+	double a = ax1 - ax2;
+	double b = by1 - by2;
+
 	double inv_norm = 1.0 / std::sqrt(a*a+b*b);
-	
-	/* Calculate gamma using the cosine relation: */
-	double gamma = acos_bounded(b * inv_norm);
-	{
-		/* The cosine relation still leaves gamma and -gamma as possible
-		 * solutions. Decide between those by evaluating the sine
-		 * relation for both solutions and deciding which of both has
-		 * the least error (one should be in order of machine precision)
-		 */
-		double sgamma = std::sin(gamma);
-		double err1 = std::abs(sgamma - a * inv_norm);
-		double err2 = std::abs(sgamma + a * inv_norm);
-		if (err1 > err2){
-			gamma = -gamma;
+
+	/* With gamma given by cos(gamma) = b/|(a,b)| and
+	 * sin(gamma) = a/|(a,b)|, the solution is lon = psi - gamma, where
+	 * psi = asin(e/|(a,b)|). Evaluate its cosine and sine using the
+	 * angle difference identities: */
+	double spsi = e * inv_norm;
+	if (spsi > 1.0){
+		spsi = 1.0;
+	} else if (spsi < -1.0){
+		spsi = -1.0;
+	}
+	double cpsi = std::sqrt(1.0 - spsi*spsi);
+
+	c = (cpsi * b + spsi * a) * inv_norm;
+	s = (spsi * b - cpsi * a) * inv_norm;
+
+	/* Rounding errors of e, a, and b relative to |(a,b)| change psi
+	 * by a factor 1/cos(psi) more and gamma by about as much: */
+	double coeff_error = BORDER_ERROR
+	        * (std::abs(e) + std::abs(ax1) + std::abs(ax2) + std::abs(by1)
+	           + std::abs(by2)) * inv_norm;
+	error = coeff_error / cpsi;
+	if (bound){
+		/* Close to cos(psi) = 0, i.e. for an arc that is about to
+		 * vanish or a site just below the tide, use that asin is Hoelder
+		 * continuous, |asin(x) - asin(y)| <= pi/sqrt(2) * sqrt(|x-y|): */
+		*bound = coeff_error
+		         + std::min(error, 2.25 * std::sqrt(coeff_error));
+	}
+	/* The second solution psi' = pi - psi is at angle 2*psi' from the
+	 * border. The exact test cannot separate them if the error is
+	 * comparable: */
+	if (!(error < 0.25 * std::abs(cpsi))){
+		error = 4.0;
+	}
+}
+
+//----------------------------------------------------------------------
+bool ArcIntersect::left_border_side(const double p[3], int& side) const
+{
+	if (!(z1 < p[2] && z2 < p[2]) || (p[0] == 0.0 && p[1] == 0.0)){
+		return false;
+	}
+	const double left[3] = {x2, y2, z2};
+	const double site[3] = {x1, y1, z1};
+	double d = beach_side(left, site, p);
+	side = (d > 0.0) ? 1 : ((d < 0.0) ? -1 : 0);
+
+	/* The arcs intersect in the border and in the second solution of
+	 * left_direction. Between both lies the arc of the higher site,
+	 * around the direction (a,b) if it is this arc's site and around
+	 * -(a,b) otherwise. If the arc is narrow, p may be close to both,
+	 * so that the side of the second intersection is taken from the
+	 * side of p relative to that direction: */
+	double a = (p[2] - z2) * x1 - (p[2] - z1) * x2;
+	double b = (p[2] - z2) * y1 - (p[2] - z1) * y2;
+	if (a * p[1] - b * p[0] > 0.0){
+		if (z1 >= z2 && side >= 0){
+			side = -1;
+		} else if (z1 < z2 && side <= 0){
+			side = 1;
 		}
 	}
-	
-	/* Now we can calculate the longitude: */
-	double s = e*inv_norm;
-	double lon = -gamma + asin_bounded(e * inv_norm);
+	return true;
+}
+
+//----------------------------------------------------------------------
+double ArcIntersect::lon_left(double tide, double anchor, bool correct)
+    const
+{
+	double c, s;
+	left_direction(Tide(tide), c, s, correct);
+	double lon = std::atan2(s, c);
 	
 	/* We need to make sure the longitude is inside the bounds: */
 	if (lon < 0.0){
@@ -157,38 +275,52 @@ double ArcIntersect::lon_left(double tide, double anchor, bool correct)
 }
 
 
+//----------------------------------------------------------------------
+static double pseudo_angle(double c, double s, double c_anchor,
+                           double s_anchor)
+{
+	/* Returns a value in (0,4] that increases monotonously with the
+	 * angle of the direction (c,s) counted counterclockwise from the
+	 * anchor direction, similar to the longitudes relative to an anchor
+	 * in lon_left. Directions that coincide with the anchor are mapped
+	 * to the upper end of the range. */
+	double x = c * c_anchor + s * s_anchor;
+	double y = s * c_anchor - c * s_anchor;
+	double p;
+	if (y >= 0.0){
+		p = (x >= 0.0) ? y / (x + y) : 1.0 - x / (y - x);
+	} else {
+		p = (x < 0.0) ? 2.0 - y / (-x - y) : 3.0 + x / (x - y);
+	}
+	return (p <= 0.0) ? 4.0 : p;
+}
 
 
 
 /* ****************************************************************** */
 /*                         class BeachSiteData                        */
 /* ****************************************************************** */
-BeachSiteData::BeachSiteData(const std::shared_ptr<bool>& valid)
-	: valid_(valid)
+BeachSiteData::BeachSiteData() : event(NO_EVENT)
 {
 }
 
 //----------------------------------------------------------------------	
-void BeachSiteData::register_circle_event_ptr(
-	const std::shared_ptr<bool>& valid)
+bool BeachSiteData::has_circle_event() const
 {
-	valid_ = valid;
+	return event != NO_EVENT;
 }
 
-//----------------------------------------------------------------------	
-void BeachSiteData::invalidate()
-{
-	if (valid_){
-//		std::cout << "   invalidate circle event (" << &*valid_ << ")\n";
-		*valid_ = false;
-		valid_.reset();
-	}
-}
 
-//----------------------------------------------------------------------	
-std::shared_ptr<bool> BeachSiteData::valid() const
+
+
+/* ****************************************************************** */
+/*                          struct BeachSite                          */
+/* ****************************************************************** */
+BeachSite::BeachSite(size_t id, const SphereVector& vec,
+                     const SphereVector& left)
+    : arc(id, vec, left), parent(nullptr), child{nullptr, nullptr},
+      red(true)
 {
-	return valid_;
 }
 
 
@@ -197,48 +329,40 @@ std::shared_ptr<bool> BeachSiteData::valid() const
 /* ****************************************************************** */
 /*                         class BeachIterator                        */
 /* ****************************************************************** */
-BeachIterator::BeachIterator(Beach* beach,
-                             BeachIterator::internal_iterator it_,
-                             double tide)
-    : beach(beach), it(it_), tide_(tide)
+BeachIterator::BeachIterator(Beach* beach, BeachSite* site, double tide)
+    : tide_(tide), site(site), beach(beach)
 {
 	/* Periodic wrapping: */
-	if (it == beach->data.end()){
-		it = beach->data.begin();
+	if (!site){
+		this->site = beach->leftmost;
 	}
 }
 
 
 //----------------------------------------------------------------------	
-std::pair<const ArcIntersect, BeachSiteData>& BeachIterator::operator*() 
+BeachSite& BeachIterator::operator*() 
 {
-	return *it;
+	return *site;
 }
 
 //----------------------------------------------------------------------	
-const std::pair<const ArcIntersect, BeachSiteData>*
-	BeachIterator::operator->() const 
+const BeachSite* BeachIterator::operator->() const 
 {
-	const std::pair<const ArcIntersect, BeachSiteData>* dat
-		 = it.operator->();
-	return dat;
+	return site;
 }
 
 //----------------------------------------------------------------------	
-std::pair<const ArcIntersect, BeachSiteData>* 
-	BeachIterator::operator->()
+BeachSite* BeachIterator::operator->()
 {
-	std::pair<const ArcIntersect, BeachSiteData>* dat
-		 = it.operator->();
-	return dat;
+	return site;
 }
 
 //----------------------------------------------------------------------	
 BeachIterator& BeachIterator::operator++()
 {
-	++it;
-	if (it == beach->data.end()){
-		it = beach->data.begin();
+	site = Beach::next(site);
+	if (!site){
+		site = beach->leftmost;
 	}
 	return *this;
 }
@@ -246,10 +370,11 @@ BeachIterator& BeachIterator::operator++()
 //----------------------------------------------------------------------	
 BeachIterator& BeachIterator::operator--()
 {
-	if (it == beach->data.begin()){
-		it = beach->data.end();
+	if (site == beach->leftmost){
+		site = beach->rightmost;
+	} else {
+		site = Beach::prev(site);
 	}
-	--it;
 	return *this;
 }
 
@@ -262,31 +387,41 @@ double BeachIterator::tide() const
 //----------------------------------------------------------------------
 const SphereVector& BeachIterator::vec() const
 {
-	return it->first.vec();
+	return site->arc.vec();
 }
 
 //----------------------------------------------------------------------
 size_t BeachIterator::id() const
 {
-	return it->first.id();
+	return site->arc.id();
 }
 
 
 //----------------------------------------------------------------------	
-bool BeachIterator::lon_left_equal(double lon, double tolerance) const
-{
-	/* Anchor from beach's first element: */
-	double anchor = beach->data.begin()->first.lon_left(tide_, 0.0,
-	                                                    false);
-	
-	/* Transform longitude using anchor: */
-	lon -= anchor;
-	if (lon <= 0.0)
-		lon += 2*M_PI;
-	
-	double dlon = it->first.lon_left(tide_, anchor) - lon;
+bool BeachIterator::lon_left_equal(double lon) const
+{
+	double p[3];
+	unit_vector(lon, tide_, p);
+
+	/* Difference of the longitudes in [-pi,pi]: */
+	double c, s, error, bound;
+	site->arc.left_direction(Tide(tide_), c, s, error, &bound);
+	double dlon = std::atan2(s, c) - lon;
+	if (dlon > M_PI){
+		dlon -= 2*M_PI;
+	} else if (dlon < -M_PI){
+		dlon += 2*M_PI;
+	}
 
-	return  dlon > -tolerance && dlon < tolerance;
+	/* Only a site that lies exactly on the border is reported. In all
+	 * other cases, including those in which the exact test does not
+	 * apply, the site is inserted by splitting the arc. A site on the
+	 * border then splits off an arc of length zero whose circle event
+	 * lies at the tide and is decided exactly: */
+	double band = BORDER_BAND + bound;
+	int side;
+	return dlon > -band && dlon < band &&
+	       site->arc.left_border_side(p, side) && side == 0;
 }
 
 
@@ -294,8 +429,8 @@ bool BeachIterator::lon_left_equal(double lon, double tolerance) const
 //----------------------------------------------------------------------	
 bool BeachIterator::is_valid() const
 {
-	for (auto it2=beach->data.begin(); it2 != beach->data.end(); ++it2){
-		if (&*it == &*it2){
+	for (const BeachSite* s = beach->leftmost; s; s = Beach::next(s)){
+		if (s == site){
 			return true;
 		}
 	}
@@ -307,59 +442,37 @@ bool BeachIterator::is_valid() const
 /*                            class Beach                             */
 /* ****************************************************************** */
 Beach::Beach(size_t id1, const SphereVector& v1, size_t id2,
-             const SphereVector& v2)
-    : compare(&tide, &anchor, &first_arc), data(compare)
+             const SphereVector& v2, CircleEventQueue& circle_events)
+    : circle_events(circle_events)
 {
 	tide =   v2.lat();
-	anchor = v1.lon();
-	OrderParameter middle
-	    = OrderParameter::between(OrderParameter::max(),
-	                              OrderParameter::min());
-	OrderParameter left
-	    = OrderParameter::between(OrderParameter::min(), middle);
-	OrderParameter right
-	    = OrderParameter::between(OrderParameter::max(), middle);
-	ArcIntersect b1(left, id1, v1, v2);
-	ArcIntersect b2(right, id2, v2, v1);
-	data.insert(BeachSite(b1, BeachSiteData()));
-	data.insert(BeachSite(b2, BeachSiteData()));
+	insert_before(nullptr, allocate_site(id1, v1, v2));
+	insert_before(nullptr, allocate_site(id2, v2, v1));
 }
 
 //----------------------------------------------------------------------
 Beach::Beach(const std::vector<size_t>& ids,
              const std::vector<SphereVector>& vecs,
-             eventqueue_t& circle_events)
-    : compare(&tide, &anchor, &first_arc), data(compare)
+             CircleEventQueue& circle_events)
+    : circle_events(circle_events)
 {
 	tide   = vecs[0].lat();
-	anchor = vecs[0].lon();
 
-	/* Step 1: Insert all nodes to beach: */
-	double max = std::numeric_limits<unsigned long>::max();
-	std::vector<BeachIterator> iterators;
-	iterators.reserve(vecs.size());
+	/* Insert all nodes to beach (they are ordered by longitude) and
+	 * create circle events for the new node at the north pole: */
 	size_t l = vecs.size()-1;
 	for (size_t i=0; i<vecs.size(); ++i){
-		unsigned long ul = (max * (0.1+0.4*vecs[i].lon()/M_PI));
-		OrderParameter op(ul);
-		ArcIntersect ai(op, ids[i], vecs[i], vecs[l]);
-		iterators.emplace_back(this, data.insert(BeachSite(ai,
-		                       BeachSiteData())).first, tide);
+		BeachSite* site = allocate_site(ids[i], vecs[i], vecs[l]);
+		insert_before(nullptr, site);
 		l = (l+1) % vecs.size();
-	}
-
 
-	/* Step 2: Create circle events for the new node at the north
-	 *         pole: */
-	l = vecs.size()-1;
-	for (size_t i=0; i<vecs.size(); ++i){
 		/* This circle event's circumcenter is the north pole (lat=0.5pi).
 		 * Its tide is thus 0.5pi + dist(northpole, vec) = 0.5pi + (0.5pi-tide)
+		 * The error is that of the sites' latitude and of the difference:
 		 */
-		CircleEvent event(M_PI-tide, iterators[i]);
-		event.set_valid();
-		circle_events.push(event);
-		iterators[i]->second.register_circle_event_ptr(event.valid_);
+		circle_events.push(CircleEvent(M_PI-tide, site,
+		    latitude_error(tide)
+		    + 8.0 * std::numeric_limits<double>::epsilon()));
 	}
 }
 
@@ -368,12 +481,11 @@ Beach::Beach(const std::vector<size_t>& ids,
 //----------------------------------------------------------------------
 BeachIterator Beach::begin(double tide)
 {
-	return BeachIterator(this, data.begin(), tide);
+	return BeachIterator(this, leftmost, tide);
 }
 
 //----------------------------------------------------------------------
-BeachIterator Beach::find_insert_position(double d, double tide,
-                                          double tolerance)
+BeachIterator Beach::find_insert_position(double d, double tide)
 {
 	/* A check if tide increases (or at least behaves monotonely): */
 	if (check_increasing_tide && tide < this->tide){
@@ -392,15 +504,11 @@ BeachIterator Beach::find_insert_position(double d, double tide,
 	 * To represent the order of that set during the search, we have
 	 * to gauge the longitude coordinates so that they begin at the
 	 * anchor position.
-	 * Because the first element is guaranteed to be less than all
-	 * requested longitudes regardless of the result of its lon_left,
-	 * we can safely add a small additional constant (the tolerance)
-	 * to the anchor.
-	 * This guarantess that, if the left border of the first element
-	 * (calculated) is less than the node longitude to the left. This
-	 * can happen if the node to the left has been inserted at the
-	 * current tide. It will happen especially often on certain
-	 * regular grids.
+	 * Borders close to the anchor may be calculated on the wrong side
+	 * of it. This can happen if the node to the left has been
+	 * inserted at the current tide, or if the first arc is about to
+	 * vanish. It will happen especially often on certain regular
+	 * grids.
 	 * Example: Node i (15°,15°) added in left of node j (30°,10°).
 	 * Now we insert node k at latitude 15° and request borders.
 	 * Because Node i has been added at lat. 15°, it will be
@@ -408,99 +516,121 @@ BeachIterator Beach::find_insert_position(double d, double tide,
 	 * numerical error, such that j.left_border(15°)=14.9999999999995°
 	 * Because of this, node i, which should have border=360°,
 	 * will have left border = 5e-13. The order is broken.
-	 * Such errors are especially frequent for regular lattices. To
-	 * increase the algorithms stability, a small tolerance is
-	 * added to the anchor (remember that this has no effect on the
-	 * first node).
+	 * Such borders are hence placed by the position of their arc:
+	 * They lie right of the anchor if the arc follows the first arc
+	 * through a sequence of arcs whose borders are all close to the
+	 * anchor (see follows_anchor), and left of it otherwise.
+	 * The anchor itself is uncertain by its error bound, which is
+	 * large if the first arc is bounded by that of a site just below
+	 * the tide.
 	 */
-	anchor = data.begin()->first.lon_left(tide, 0.0, false)+tolerance;
+	Tide t(tide);
+	double c_anchor, s_anchor, anchor_error, anchor_bound;
+	leftmost->arc.left_direction(t, c_anchor, s_anchor, anchor_error,
+	                             &anchor_bound);
+	const double anchor_band = BORDER_BAND + anchor_bound;
 
 	/* All nodes with (corrected) lon=0.0 will be shifted to 360.0°
 	 * to keep ordering such that the first node stays first.
 	 * However, the first node also has corrected lon=0.0. Alas,
-	 * we need some other means to mark that node. Do it with
-	 * pointers!
-	 */
-	first_arc = &data.begin()->first;
-	
-	/* Find iterator: */
-	BeachIterator::internal_iterator it = data.lower_bound<double>(d);
+	 * we need some other means to mark that node. Since it is the
+	 * leftmost node of the tree, we simply compare pointers.
+	 * The longitudes are compared by their directions relative to the
+	 * anchor so that the descent needs no trigonometric functions.
+	 * A site close to the anchor is placed exactly relative to it: */
+	double p[3];
+	unit_vector(d, tide, p);
+	double lon = pseudo_angle(std::cos(d), std::sin(d), c_anchor,
+	                          s_anchor);
+	int side;
+	if ((lon < anchor_band || lon > 4.0 - anchor_band) &&
+	    leftmost->arc.left_border_side(p, side))
+	{
+		lon = (side < 0) ? 0.0 : 4.0;
+	}
+
+	/* Find the first arc whose left border is not less than lon
+	 * (lower bound). Borders too close to lon are compared exactly: */
+	BeachSite* x = root;
+	BeachSite* bound = nullptr;
+	while (x){
+		if (x == leftmost){
+			x = x->child[1];
+			continue;
+		}
+		double c, s, error, error_bound;
+		x->arc.left_direction(t, c, s, error, &error_bound);
+		double border = pseudo_angle(c, s, c_anchor, s_anchor);
+		double band = BORDER_BAND + error_bound;
+		double near = anchor_band + error_bound;
+		bool less;
+		if (border > lon - band && border < lon + band &&
+		    x->arc.left_border_side(p, side))
+		{
+			less = (side < 0);
+		} else if (border < near || border > 4.0 - near){
+			/* If the last arc's site lies at the tide, the anchor is the
+			 * site's longitude, and its arc of width zero lies at the
+			 * end: */
+			bool last = (x == rightmost && x->arc.at_tide(t));
+			less = (!last &&
+			        follows_anchor(x, t, c_anchor, s_anchor, anchor_band)
+			        ? 0.0 : 4.0) < lon;
+		} else {
+			less = border < lon;
+		}
+		if (less){
+			x = x->child[1];
+		} else {
+			bound = x;
+			x = x->child[0];
+		}
+	}
 		
 	/* Construct iterator: */
-	return BeachIterator(this, it, tide);
+	return BeachIterator(this, bound, tide);
 	
 }
 
 //----------------------------------------------------------------------
-BeachIterator Beach::insert_before(const BeachIterator& pos, size_t id,
-		                           const SphereVector& vec)
-{
-	/* Get information about the node pointed to by it.
-	 * This is necessary because we have to replace it (its 'left'
-	 * vector needs to be replaced). */
-	ArcIntersect r = pos->first;
-	r.left_ = vec;
-	
-	
-	/* Replace r: */
-	BeachSiteData site_data = pos->second;
-	auto it = data.erase(pos.it);
-	it = data.insert(it, BeachSite(r, site_data));
-	
-	/* Get information about left node: */
-	ArcIntersect l;
-	if (it == data.begin()){
-		it = data.end();
-		--it;
-		l = it->first;
-		it = data.begin();
-	} else {
-		--it;
-		l = it->first;
-		++it;
-	}
-	
-	
-	/* Construct beach site to be inserted: */
-	OrderParameter p;
-	if (l.pos < r.pos){
-		/* Set position to be middle between both: */
-		p = OrderParameter::between(l.pos, r.pos);
-	} else if (l.pos > r.pos){
-		/* Set position to either be in between left and 2.0
-		 * or right and 0.0 - whichever is the bigger interval.
-		 * This should cause the position interval [0.0, 2.0] to
-		 * stay somewhat uniformly sampled. */
-		double dl = OrderParameter::max() - l.pos;
-		double dr = OrderParameter::min() - r.pos;
-		if (dr > dl){
-			p = OrderParameter::between(r.pos, OrderParameter::min());
-		} else {
-			p = OrderParameter::between(l.pos, OrderParameter::max());
+bool Beach::follows_anchor(const BeachSite* site, const Tide& tide,
+                           double c_anchor, double s_anchor,
+                           double anchor_band) const
+{
+	/* Whether the site is reached from the first arc through arcs
+	 * whose left borders are all close to the anchor: */
+	for (const BeachSite* x = next(leftmost); x; x = next(x)){
+		if (x == site){
+			return true;
+		}
+		double c, s, error, error_bound;
+		x->arc.left_direction(tide, c, s, error, &error_bound);
+		double border = pseudo_angle(c, s, c_anchor, s_anchor);
+		double near = anchor_band + error_bound;
+		if (border >= near && border <= 4.0 - near){
+			return false;
 		}
-	} else {
-		std::string str("ERROR : Beach::insert_before() :\nTwo positions "
-		    "equal!\n\tleft = ");
-		str.append(l.pos.to_string()).append("\n\tright= ")
-		   .append(r.pos.to_string()).append("\n");
-		throw std::runtime_error(str);
 	}
-	ArcIntersect m(p, id, vec, l.vec_);
-	
-	
-	/* Insert beach site: */
-	it = data.insert(it, BeachSite(m, BeachSiteData()));
-	
-	return BeachIterator(this, it, pos.tide());
+	return false;
 }
 
-
 //----------------------------------------------------------------------
-void Beach::register_circle_event(BeachIterator& pos,
-		                          const std::shared_ptr<bool>& valid)
+BeachIterator Beach::insert_before(const BeachIterator& pos, size_t id,
+		                           const SphereVector& vec)
 {
-	/* This is easy: */
-	pos->second.register_circle_event_ptr(valid);
+	/* The arc pointed to by pos obtains a new left neighbour: */
+	BeachSite* r = pos.site;
+	BeachSite* l = (r == leftmost) ? rightmost : prev(r);
+
+	BeachSite* m = allocate_site(id, vec, l->arc.vec_);
+	r->arc.set_left(vec);
+
+	/* Inserting before the first arc is, on the periodic beach,
+	 * equivalent to appending after the last arc. Do the latter
+	 * to keep the first arc (and thus the anchor) unchanged: */
+	insert_before((r == leftmost) ? nullptr : r, m);
+	
+	return BeachIterator(this, m, pos.tide());
 }
 
 
@@ -508,7 +638,7 @@ void Beach::register_circle_event(BeachIterator& pos,
 void Beach::invalidate_circle_event(BeachIterator& pos)
 {
 	/* This is easy: */
-	pos->second.invalidate();
+	circle_events.erase(pos.site);
 }
 
 
@@ -517,29 +647,27 @@ BeachIterator Beach::erase(BeachIterator& it)
 {
 	/* Invalidate left neighbour: */
 	--it;
-	it->second.invalidate();
+	circle_events.erase(it.site);
 	++it;
 	
 	/* Invalidate circle event of erased iterator: */
-	BeachSite b = *it;
-	b.second.invalidate();
+	BeachSite* site = it.site;
+	circle_events.erase(site);
 	double tide = it.tide();
 	
-	/* Obtain new iterator: */
-	auto it_new = data.erase(it.it);
-	if (it_new == data.end())
-		it_new = data.begin();
-	
-	/* For this new iterator (which is the erase element's right
-	 * neighbour), we have to update the left neighbour.
-	 * This can be done by replacing the beach site: */
-	std::pair<ArcIntersect, BeachSiteData> right = *it_new;
-	right.second.invalidate();
-	right.first.left_ = b.first.left_;
-	it_new = data.insert(data.erase(it_new), right);
+	/* For the right neighbour, we have to update the left neighbour.
+	 * This can be done in place: */
+	++it;
+	BeachSite* right = it.site;
+	circle_events.erase(right);
+	right->arc.set_left(site->arc.left_);
+
+	/* Remove the arc from the tree and recycle it: */
+	erase(site);
+	release_site(site);
 	
 	/* Create and return new BeachIterator: */
-	return BeachIterator(this, it_new, tide);
+	return BeachIterator(this, right, tide);
 }
 
 
@@ -553,36 +681,34 @@ void Beach::set_tide(double d)
 //----------------------------------------------------------------------
 size_t Beach::size() const
 {
-	return data.size();
+	return size_;
 }
 
 
 //----------------------------------------------------------------------
 void Beach::print_debug() const
 {
-	anchor = data.begin()->first.lon_left(tide, 0.0);
+	double anchor = leftmost->arc.lon_left(tide, 0.0);
 	std::cout << "\nTIDE: " << tide << ", ANCHOR: " << anchor;
-	std::cout << "\nID and sort parameter:\n{";
-	for (auto it = data.begin(); it != data.end(); ++it){
-		std::cout << it->first.id_ << "[" << it->first.pos.to_string()
-		          <<  "],"; 
+	std::cout << "\nID:\n{";
+	for (const BeachSite* s = leftmost; s; s = next(s)){
+		std::cout << s->arc.id_ << ",";
 	}
 	std::cout.precision(3);
 	std::cout << "}\ncoordinates:\n{";
-	for (auto it = data.begin(); it != data.end(); ++it){
-		std::cout << "(" << it->first.vec().lon() << "," 
-		          << it->first.vec().lat() <<  "), "; 
+	for (const BeachSite* s = leftmost; s; s = next(s)){
+		std::cout << "(" << s->arc.vec().lon() << "," 
+		          << s->arc.vec().lat() <<  "), "; 
 	}
 	std::cout << "}\nleft coordinates:\n{";
-	for (auto it = data.begin(); it != data.end(); ++it){
-		std::cout << "(" << it->first.left().lon() << "," 
-		          << it->first.left().lat() <<  "), "; 
+	for (const BeachSite* s = leftmost; s; s = next(s)){
+		std::cout << "(" << s->arc.left().lon() << "," 
+		          << s->arc.left().lat() <<  "), "; 
 	}
 	std::cout.precision(17);
 	std::cout << "}\nparabola intersects:\n{";
-	for (auto it = data.begin(); it != data.end(); ++it){
-		std::cout << it->first.lon_left(tide, anchor) 
-		          << ", "; 
+	for (const BeachSite* s = leftmost; s; s = next(s)){
+		std::cout << s->arc.lon_left(tide, anchor) << ", "; 
 	}
 	std::cout << "}\n\n";
 	
@@ -591,10 +717,10 @@ void Beach::print_debug() const
 //----------------------------------------------------------------------
 bool Beach::check_consistency(double tide) const
 {
-	double anchor = data.begin()->first.lon_left(tide, 0.0);
+	double anchor = leftmost->arc.lon_left(tide, 0.0);
 	double last_lon = 0.0;
-	for (auto it = data.begin(); it != data.end(); ++it){
-		double lon = it->first.lon_left(tide, anchor);
+	for (const BeachSite* s = leftmost; s; s = next(s)){
+		double lon = s->arc.lon_left(tide, anchor);
 		if (lon + 1e-6 < last_lon){
 			return false;
 		}
@@ -605,4 +731,247 @@ bool Beach::check_consistency(double tide) const
 }
 
 
+/* ************************ Red-black tree ************************** */
+
+//----------------------------------------------------------------------
+BeachSite* Beach::allocate_site(size_t id, const SphereVector& vec,
+                                const SphereVector& left)
+{
+	if (free_sites){
+		/* Recycle an erased arc: */
+		BeachSite* site = free_sites;
+		free_sites = site->parent;
+		*site = BeachSite(id, vec, left);
+		return site;
+	}
+	pool.emplace_back(id, vec, left);
+	return &pool.back();
+}
+
+//----------------------------------------------------------------------
+void Beach::release_site(BeachSite* site)
+{
+	site->data = BeachSiteData();
+	site->parent = free_sites;
+	free_sites = site;
+}
+
+//----------------------------------------------------------------------
+BeachSite* Beach::next(const BeachSite* site)
+{
+	if (site->child[1]){
+		site = site->child[1];
+		while (site->child[0]){
+			site = site->child[0];
+		}
+		return const_cast<BeachSite*>(site);
+	}
+	while (site->parent && site == site->parent->child[1]){
+		site = site->parent;
+	}
+	return site->parent;
+}
+
+//----------------------------------------------------------------------
+BeachSite* Beach::prev(const BeachSite* site)
+{
+	if (site->child[0]){
+		site = site->child[0];
+		while (site->child[1]){
+			site = site->child[1];
+		}
+		return const_cast<BeachSite*>(site);
+	}
+	while (site->parent && site == site->parent->child[0]){
+		site = site->parent;
+	}
+	return site->parent;
+}
+
+//----------------------------------------------------------------------
+void Beach::rotate(BeachSite* x, int dir)
+{
+	/* Rotates left for dir=0 and right for dir=1: */
+	BeachSite* y = x->child[1-dir];
+	x->child[1-dir] = y->child[dir];
+	if (y->child[dir]){
+		y->child[dir]->parent = x;
+	}
+	y->parent = x->parent;
+	if (!x->parent){
+		root = y;
+	} else if (x == x->parent->child[0]){
+		x->parent->child[0] = y;
+	} else {
+		x->parent->child[1] = y;
+	}
+	y->child[dir] = x;
+	x->parent = y;
+}
+
+//----------------------------------------------------------------------
+void Beach::insert_before(BeachSite* pos, BeachSite* site)
+{
+	/* Inserts site before pos or, if pos is nullptr, after the last
+	 * site: */
+	++size_;
+	if (!root){
+		root = leftmost = rightmost = site;
+		site->red = false;
+		return;
+	}
+
+	if (!pos){
+		rightmost->child[1] = site;
+		site->parent = rightmost;
+		rightmost = site;
+	} else if (!pos->child[0]){
+		pos->child[0] = site;
+		site->parent = pos;
+		if (pos == leftmost){
+			leftmost = site;
+		}
+	} else {
+		BeachSite* p = pos->child[0];
+		while (p->child[1]){
+			p = p->child[1];
+		}
+		p->child[1] = site;
+		site->parent = p;
+	}
+
+	insert_fixup(site);
+}
+
+//----------------------------------------------------------------------
+void Beach::insert_fixup(BeachSite* x)
+{
+	while (x != root && x->parent->red){
+		BeachSite* p = x->parent;
+		BeachSite* g = p->parent;
+		int dir = (p == g->child[0]) ? 0 : 1;
+		BeachSite* u = g->child[1-dir];
+		if (u && u->red){
+			p->red = false;
+			u->red = false;
+			g->red = true;
+			x = g;
+		} else {
+			if (x == p->child[1-dir]){
+				x = p;
+				rotate(x, dir);
+				p = x->parent;
+			}
+			p->red = false;
+			g->red = true;
+			rotate(g, 1-dir);
+		}
+	}
+	root->red = false;
+}
+
+//----------------------------------------------------------------------
+void Beach::erase(BeachSite* z)
+{
+	/* Keep track of the extremal sites: */
+	if (z == leftmost){
+		leftmost = next(z);
+	}
+	if (z == rightmost){
+		rightmost = prev(z);
+	}
+	--size_;
+
+	/* Replaces subtree u by subtree v: */
+	auto transplant = [this](BeachSite* u, BeachSite* v){
+		if (!u->parent){
+			root = v;
+		} else if (u == u->parent->child[0]){
+			u->parent->child[0] = v;
+		} else {
+			u->parent->child[1] = v;
+		}
+		if (v){
+			v->parent = u->parent;
+		}
+	};
+
+	BeachSite* x;
+	BeachSite* x_parent;
+	bool removed_red = z->red;
+	if (!z->child[0]){
+		x = z->child[1];
+		x_parent = z->parent;
+		transplant(z, x);
+	} else if (!z->child[1]){
+		x = z->child[0];
+		x_parent = z->parent;
+		transplant(z, x);
+	} else {
+		/* Relink the successor y of z in z's place. The sites are
+		 * referenced by iterators, so the nodes must not be swapped
+		 * by content: */
+		BeachSite* y = z->child[1];
+		while (y->child[0]){
+			y = y->child[0];
+		}
+		removed_red = y->red;
+		x = y->child[1];
+		if (y->parent == z){
+			x_parent = y;
+		} else {
+			x_parent = y->parent;
+			transplant(y, x);
+			y->child[1] = z->child[1];
+			y->child[1]->parent = y;
+		}
+		transplant(z, y);
+		y->child[0] = z->child[0];
+		y->child[0]->parent = y;
+		y->red = z->red;
+	}
+
+	if (!removed_red){
+		erase_fixup(x, x_parent);
+	}
+}
+
+//----------------------------------------------------------------------
+void Beach::erase_fixup(BeachSite* x, BeachSite* x_parent)
+{
+	while (x != root && (!x || !x->red)){
+		int dir = (x == x_parent->child[0]) ? 0 : 1;
+		BeachSite* w = x_parent->child[1-dir];
+		if (w->red){
+			w->red = false;
+			x_parent->red = true;
+			rotate(x_parent, dir);
+			w = x_parent->child[1-dir];
+		}
+		if ((!w->child[0] || !w->child[0]->red) &&
+		    (!w->child[1] || !w->child[1]->red))
+		{
+			w->red = true;
+			x = x_parent;
+			x_parent = x->parent;
+		} else {
+			if (!w->child[1-dir] || !w->child[1-dir]->red){
+				w->child[dir]->red = false;
+				w->red = true;
+				rotate(w, 1-dir);
+				w = x_parent->child[1-dir];
+			}
+			w->red = x_parent->red;
+			x_parent->red = false;
+			w->child[1-dir]->red = false;
+			rotate(x_parent, dir);
+			x = root;
+		}
+	}
+	if (x){
+		x->red = false;
+	}
+}
+
+
 } // NAMESPACE ACOSA
@@ -26,32 +26,75 @@
 #ifndef ACOSA_BEACH_HPP
 #define ACOSA_BEACH_HPP
 
-#include <map>
 #include <stddef.h>
 #include <math.h>
-#include <order_parameter.hpp>
 #include <spherics.hpp>
-#include <queue>
+#include <deque>
+#include <vector>
 
 namespace ACOSA {
 
 class Beach;
-class CircleEvent;
+class CircleEventQueue;
+
+/*!
+ * \brief The sine and cosine of the sweep line latitude.
+ */
+struct Tide {
+	Tide(double lat);
+
+	double lat;
+	double sin;
+	double cos;
+};
 
-typedef std::priority_queue<CircleEvent, std::vector<CircleEvent>,
-                            std::greater<CircleEvent>>
-        eventqueue_t;
 
 class ArcIntersect {
-	friend struct ArcIntersectComparator;
 	friend class Beach;
 	
 	public:
-		ArcIntersect(const OrderParameter& position, size_t id,
-		             const SphereVector& vec, const SphereVector& left);
+		ArcIntersect(size_t id, const SphereVector& vec,
+		             const SphereVector& left);
 	
 	
 		double lon_left(double tide, double anchor, bool correct=true) const;
+
+		/*!
+		 * \brief Direction (cos(lon), sin(lon)) of the arc's left border.
+		 *
+		 * Evaluates the intersection of this arc with its left neighbour
+		 * using only the arcs' unit vectors, i.e. without any
+		 * transcendental function calls.
+		 */
+		void left_direction(const Tide& tide, double& c, double& s,
+		                    bool correct=true) const;
+
+		/*!
+		 * \brief As left_direction, and a bound of the angular error
+		 *        of the direction due to rounding.
+		 *
+		 * The error is set to 4 if the border cannot be separated from
+		 * the second intersection of the arcs. If bound is not null, it
+		 * is set to a bound of the angular error that holds in that case
+		 * as well.
+		 */
+		void left_direction(const Tide& tide, double& c, double& s,
+		                    double& error, double* bound=nullptr) const;
+
+		/*!
+		 * \brief Exact side of a new site relative to the arc's left
+		 *        border.
+		 * \param p Unit vector of a site at the tide.
+		 * \param side Set to 1 if p lies left of the border, -1 if it
+		 *             lies right of it, and 0 if it lies on it.
+		 * \return False if the exact test does not apply, i.e. if the
+		 *         arc's or its neighbour's site lies at the tide or p
+		 *         lies at a pole. side is then not set.
+		 *
+		 * The test decides which arc is closer to p. It is hence valid
+		 * only for p close to the border.
+		 */
+		bool left_border_side(const double p[3], int& side) const;
 		
 		
 		size_t id() const;
@@ -62,15 +105,20 @@ class ArcIntersect {
 		
 	
 	private:
-		ArcIntersect();
-		
 		size_t       id_;
 		SphereVector vec_;
 		SphereVector left_;
 
-		
-		/* This is used for ordering: */
-		OrderParameter pos;
+		/* Precomputed Euclidean coordinates of vec_ and left_, and the
+		 * direction of vec_'s longitude: */
+		double x1, y1, z1, clon1, slon1;
+		double x2, y2, z2;
+
+		void set_left(const SphereVector& left);
+
+		bool at_tide(const Tide& tide) const;
+
+		bool left_at_tide(const Tide& tide) const;
 };
 
 
@@ -79,24 +127,45 @@ class ArcIntersect {
 
 
 class BeachSiteData {
+	friend class CircleEventQueue;
+
 	public:
-		BeachSiteData(const std::shared_ptr<bool>& valid = 
-					  std::shared_ptr<bool>());
-	
-		void register_circle_event_ptr(const std::shared_ptr<bool>& 
-		                               valid);
-		
-		std::shared_ptr<bool> valid() const;
-		
-		void invalidate();
-		
+		constexpr static size_t NO_EVENT = -1;
+
+		BeachSiteData();
+
+		bool has_circle_event() const;
+
 	private:
-		/* A reference to the circle event: */
-		std::shared_ptr<bool> valid_;
+		/* The handle of the arc's circle event, i.e. its position in
+		 * the circle event queue: */
+		size_t event;
 };
 
 
 
+/*!
+ * \brief A node of the beach line.
+ *
+ * The beach stores its arcs in an intrusive red-black tree whose order is
+ * given solely by the structure of the tree (there is no sort key). This
+ * allows inserting new arcs at a known position, updating an arc's left
+ * neighbour in place, and recycling erased arcs from a pool.
+ */
+struct BeachSite {
+	BeachSite(size_t id, const SphereVector& vec, const SphereVector& left);
+
+	ArcIntersect  arc;
+	BeachSiteData data;
+
+	private:
+		friend class Beach;
+
+		BeachSite* parent;
+		BeachSite* child[2];
+		bool       red;
+};
+
 
 
 
@@ -108,24 +177,21 @@ class Beach {
 	
 	public:
 	    Beach(size_t id1, const SphereVector& v1, size_t id2,
-		      const SphereVector& v2);
+		      const SphereVector& v2, CircleEventQueue& circle_events);
 
 		Beach(const std::vector<size_t>& ids,
 		      const std::vector<SphereVector>& vecs,
-		      eventqueue_t& circle_events);
+		      CircleEventQueue& circle_events);
 		
 		BeachIterator begin(double tide);
 		
-		BeachIterator find_insert_position(double d, double tide,
-		                                   double tolerance);
+		BeachIterator find_insert_position(double d, double tide);
 		
-		/* Warning: The iterator 'pos' is invalidated! */
+		/* The iterator 'pos' stays valid and its arc's left vector is
+		 * updated to 'vec'. */
 		BeachIterator insert_before(const BeachIterator& pos, size_t id,
 		                            const SphereVector& vec);
 		
-		void register_circle_event(BeachIterator& pos,
-		                           const std::shared_ptr<bool>& valid);
-		
 		void invalidate_circle_event(BeachIterator& pos);
 		
 		BeachIterator erase(BeachIterator& pos);
@@ -141,88 +207,59 @@ class Beach {
 	private:
 		constexpr static bool check_increasing_tide = true;
 		
-		mutable double tide   = 0.0;
-		mutable double anchor = 0.0;
-		mutable const ArcIntersect* first_arc = nullptr;
-	
-		struct ArcIntersectComparator
-		{
-			using is_transparent = std::true_type;
-			
-			ArcIntersectComparator(double* tide, double* anchor,
-			                       const ArcIntersect** first)
-			    : tide(tide), anchor(anchor), first(first)
-			{}
-			
-			
-			/* Comparison data: */
-			double* tide = nullptr;
-			double* anchor = nullptr;
-			const ArcIntersect* const * first = nullptr;
-
-
-			/* Comparison operators: */
-			
-			/* Compare beach sites by their ordering parameter: */
-			bool operator()(const ArcIntersect& l, const ArcIntersect& r) const
-			{
-				return l.pos < r.pos;
-			}
-			
-			/* Compare a beach site with a double by comparing the double to
-			 * the left border of the arc: */
-			bool operator()(const ArcIntersect& l, double lon) const
-			{
-				if (&l == *first)
-					return true;
-
-				lon -= *anchor;
-				if (lon <= 0.0)
-					lon += 2*M_PI;
-
-				return l.lon_left(*tide, *anchor) < lon;
-			}
-			
-			bool operator()(double lon, const ArcIntersect& r) const
-			{
-				if (&r == *first)
-					return false;
-
-				lon -= *anchor;
-				if (lon <= 0.0)
-					lon += 2*M_PI;
-
-				return lon < r.lon_left(*tide, *anchor);
-			}
-		};
+		double tide   = 0.0;
 
-	
-		ArcIntersectComparator compare;
-	
-		std::map<ArcIntersect,BeachSiteData,ArcIntersectComparator> data;
+		/* The circle events of the arcs: */
+		CircleEventQueue& circle_events;
+
+		/* The red-black tree: */
+		BeachSite* root     = nullptr;
+		BeachSite* leftmost = nullptr;
+		BeachSite* rightmost = nullptr;
+		size_t     size_     = 0;
+
+		/* Storage of the tree nodes. Erased arcs are kept in a free list
+		 * (linked by their parent pointer) and recycled on insertion: */
+		std::deque<BeachSite> pool;
+		BeachSite* free_sites = nullptr;
+
+		BeachSite* allocate_site(size_t id, const SphereVector& vec,
+		                         const SphereVector& left);
+
+		void release_site(BeachSite* site);
+
+		static BeachSite* next(const BeachSite* site);
+
+		static BeachSite* prev(const BeachSite* site);
+
+		bool follows_anchor(const BeachSite* site, const Tide& tide,
+		                    double c_anchor, double s_anchor,
+		                    double anchor_band) const;
+
+		void rotate(BeachSite* x, int dir);
+
+		void insert_before(BeachSite* pos, BeachSite* site);
+
+		void insert_fixup(BeachSite* x);
+
+		void erase(BeachSite* site);
+
+		void erase_fixup(BeachSite* x, BeachSite* x_parent);
 };
 
 /* An iterator  */
 class BeachIterator {
 	friend class Beach;
-	friend class CircleEvent;
 	
 	
 	public:
-		typedef
-		std::map<ArcIntersect, BeachSiteData, 
-			Beach::ArcIntersectComparator>::iterator
-		internal_iterator;
+		BeachIterator(Beach* beach, BeachSite* site, double tide);
 	
-		BeachIterator(Beach* beach, internal_iterator it,
-		              double tide);
-	
-		std::pair<const ArcIntersect, BeachSiteData>& operator*();
+		BeachSite& operator*();
 		
-		std::pair<const ArcIntersect, BeachSiteData>* operator->();
+		BeachSite* operator->();
 		
-		const std::pair<const ArcIntersect, BeachSiteData>* operator->()
-			const;
+		const BeachSite* operator->() const;
 		
 		BeachIterator& operator++();
 		
@@ -234,7 +271,10 @@ class BeachIterator {
 	
 		double tide() const;
 		
-		bool lon_left_equal(double lon, double tolerance) const;
+		/* Whether the left border of the arc equals the longitude of
+		 * a site at the tide. The test is exact. It is false whenever
+		 * left_border_side does not apply: */
+		bool lon_left_equal(double lon) const;
 	
 		/* For debugging purposes: */
 		bool is_valid() const;
@@ -242,17 +282,12 @@ class BeachIterator {
 	private:
 		double tide_;
 	
-		internal_iterator it;
+		BeachSite* site;
 		
 		Beach* beach;
 };
 
 
-
-
-
-typedef std::pair<const ArcIntersect, BeachSiteData> BeachSite;
-
 } // NAMESPACE ACOSA
 
 #endif // ACOSA_BEACH_HPP
@@ -24,41 +24,87 @@
  */
 
 #include <circleevent.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace ACOSA {
 
+/* Half the machine epsilon, i.e. the relative rounding error: */
+static constexpr double EPSILON = 0.5 * std::numeric_limits<double>::epsilon();
+
+
 //----------------------------------------------------------------------
-CircleEvent::CircleEvent(const SphereVector& v1, const SphereVector& v2,
-    const SphereVector& v3, const BeachIterator& it, double tolerance)
-    : beach_site(it)
+CircleEvent::CircleEvent(size_t i1, size_t i2, size_t i3,
+    const EuclidTable& nodes, BeachSite* site)
+    : site_(site)
 {
-	/* Calculate circumcenter: */
-	SphereVectorEuclid e1(v1), e2(v2), e3(v3);
-	SphereVectorEuclid cc = SphereVectorEuclid::circumcenter(e1,e2,e3);
+	const double* x = nodes.x.data();
+	const double* y = nodes.y.data();
+	const double* z = nodes.z.data();
+
+	/* Calculate circumcenter, following
+	 * SphereVectorEuclid::circumcenter: cc = -(v1-v2) x (v3-v2) */
+	double ax = x[i1] - x[i2], ay = y[i1] - y[i2], az = z[i1] - z[i2];
+	double bx = x[i3] - x[i2], by = y[i3] - y[i2], bz = z[i3] - z[i2];
+	double ccx = az*by - ay*bz;
+	double ccy = ax*bz - az*bx;
+	double ccz = ay*bx - ax*by;
+	double norm2 = ccx*ccx + ccy*ccy + ccz*ccz;
+	double inv_norm = 1.0 / std::sqrt(norm2);
+	ccx *= inv_norm;
+	ccy *= inv_norm;
+	ccz *= inv_norm;
 
-	/* Calculate maximum latitude of circumcircle: */
-	double d = cc.distance(e1);
+	/* The maximum latitude of the circumcircle is the latitude of the
+	 * circumcenter plus the circle's radius d. Sum both angles using
+	 * their sines and cosines, so that only one inverse trigonometric
+	 * function is needed: */
+	double clat = std::sqrt(ccx*ccx + ccy*ccy);
+	double cd = ccx*x[i1] + ccy*y[i1] + ccz*z[i1];
+	double sx = ccy*z[i1] - ccz*y[i1];
+	double sy = ccz*x[i1] - ccx*z[i1];
+	double sz = ccx*y[i1] - ccy*x[i1];
+	double sd = std::sqrt(sx*sx + sy*sy + sz*sz);
 
-	lat_ = cc.lat() + d;
+	lat_ = std::atan2(ccz*cd + clat*sd, clat*cd - ccz*sd);
 
-	/* Be certain to avoid numerical errors: */
-	double vec_lat = std::max(v1.lat(), std::max(v2.lat(),
-	                          v3.lat()));
-	double dist = lat_ - vec_lat;
-	if (dist > -tolerance && dist < tolerance){
-		lat_ = vec_lat;
+	/* The sum lies within [-pi/2, 3pi/2]: */
+	if (lat_ < -0.5*M_PI){
+		lat_ += 2*M_PI;
 	}
 
-	/* Copy iterator and set new latitude: */
-	beach_site.tide_ = lat_;
+	/* Bound of the rounding error:
+	 * 1) The differences a and b are exact up to a relative error eps
+	 *    in each component, so each component of the cross product
+	 *    is off by at most 4*eps*(|a_i b_j| + |a_j b_i|), and the cross
+	 *    product by 4*sqrt(2)*eps*|a||b|. This turns the direction of
+	 *    the circumcenter by up to 6*eps*|a||b|/|cc|, which changes
+	 *    both its latitude and the radius d by as much.
+	 * 2) The table's coordinates are off by at most 5*eps (two
+	 *    function evaluations to within one ulp and a product), so
+	 *    that | |v1|^2 - 1 | <= 10*eps. The computed sd is then the
+	 *    sine of the radius of the circle through v1 on the unit
+	 *    sphere up to 10*eps/sd.
+	 * 3) The remaining operations act on numbers bounded by about one
+	 *    and change the angle by less than 64*eps, including atan2
+	 *    and the shift by 2pi.
+	 * The factor 12 of the second term leaves room for the rounding of
+	 * the bound itself. Degenerate triangles have no finite bound:
+	 */
+	double ab = std::sqrt((ax*ax + ay*ay + az*az) * (bx*bx + by*by + bz*bz)
+	                      / norm2);
+	error_ = EPSILON * (12.0 * ab + 12.0 / sd + 64.0);
+	if (!(error_ < 1.0)){
+		error_ = std::numeric_limits<double>::infinity();
+	}
 }
 
 
 //----------------------------------------------------------------------
-CircleEvent::CircleEvent(double lat, const BeachIterator& it)
-    : beach_site(it), lat_(lat)
+CircleEvent::CircleEvent(double lat, BeachSite* site, double error)
+    : lat_(lat), error_(error), site_(site)
 {
-	beach_site.tide_ = lat_;
 }
 
 
@@ -69,6 +115,18 @@ double CircleEvent::lat() const
 	return lat_;
 }
 
+//----------------------------------------------------------------------
+double CircleEvent::error() const
+{
+	return error_;
+}
+
+//----------------------------------------------------------------------
+BeachSite* CircleEvent::site() const
+{
+	return site_;
+}
+
 
 //----------------------------------------------------------------------
 bool CircleEvent::operator<(const CircleEvent& other) const
@@ -82,30 +140,167 @@ bool CircleEvent::operator>(const CircleEvent& other) const
 	return lat_ > other.lat_;
 }
 
+
+
+//----------------------------------------------------------------------
+double latitude_error(double lat)
+{
+	/* The table's z = sin(lat) is exact to within one ulp, i.e. off by
+	 * at most 2*eps*|z|. By the mean value theorem, asin(z) is then off
+	 * by at most 2*eps*|z| / cos(xi) for some xi within that distance
+	 * of lat. As long as the distance is less than cos(lat)/2, i.e.
+	 * for cos(lat)^2 > 8*eps, we have cos(xi) > cos(lat)/2: */
+	double c = std::cos(lat);
+	if (!(c*c > 8.0 * EPSILON)){
+		return std::numeric_limits<double>::infinity();
+	}
+	return 5.0 * EPSILON * std::abs(std::sin(lat)) / c;
+}
+
+
+
+/* ****************************************************************** */
+/*                       class CircleEventQueue                       */
+/* ****************************************************************** */
+
 //----------------------------------------------------------------------
-void CircleEvent::set_beach_site_iterator(const BeachIterator&
-    iterator)
+void CircleEventQueue::push(const CircleEvent& event)
 {
-	beach_site = iterator;
+	++pushed_;
+	size_t i = event.site()->data.event;
+	if (i == BeachSiteData::NO_EVENT){
+		/* New event: */
+		heap.push_back(event);
+		sift_up(heap.size()-1, event);
+		return;
+	}
+	++removed_;
+	if (event < heap[i]){
+		sift_up(i, event);
+	} else {
+		sift_down(i, event);
+	}
 }
 
 //----------------------------------------------------------------------
-void CircleEvent::invalidate(){
-	if (valid_){
-		*valid_ = false;
-		valid_.reset();
+void CircleEventQueue::erase(BeachSite* site)
+{
+	size_t i = site->data.event;
+	if (i != BeachSiteData::NO_EVENT){
+		++removed_;
+		remove(i);
 	}
 }
 
 //----------------------------------------------------------------------
-void CircleEvent::set_valid() {
-	valid_ = std::make_shared<bool>(true);
+const CircleEvent& CircleEventQueue::event(const BeachSite* site) const
+{
+	return heap[site->data.event];
+}
+
+//----------------------------------------------------------------------
+const CircleEvent& CircleEventQueue::top() const
+{
+	return heap.front();
+}
+
+//----------------------------------------------------------------------
+void CircleEventQueue::pop()
+{
+	++removed_;
+	remove(0);
 }
 
 //----------------------------------------------------------------------
-bool CircleEvent::valid() const
+bool CircleEventQueue::empty() const
 {
-	return valid_ && *valid_;
+	return heap.empty();
+}
+
+//----------------------------------------------------------------------
+size_t CircleEventQueue::size() const
+{
+	return heap.size();
+}
+
+//----------------------------------------------------------------------
+size_t CircleEventQueue::pushed() const
+{
+	return pushed_;
+}
+
+//----------------------------------------------------------------------
+size_t CircleEventQueue::removed() const
+{
+	return removed_;
+}
+
+//----------------------------------------------------------------------
+void CircleEventQueue::place(size_t i, const CircleEvent& event)
+{
+	heap[i] = event;
+	event.site()->data.event = i;
+}
+
+//----------------------------------------------------------------------
+void CircleEventQueue::sift_up(size_t i, const CircleEvent& event)
+{
+	/* Move parents down until the event's position is found: */
+	while (i > 0){
+		size_t parent = (i-1) / D;
+		if (!(event < heap[parent])){
+			break;
+		}
+		place(i, heap[parent]);
+		i = parent;
+	}
+	place(i, event);
+}
+
+//----------------------------------------------------------------------
+void CircleEventQueue::sift_down(size_t i, const CircleEvent& event)
+{
+	/* Move the smallest children up until the event's position is
+	 * found: */
+	const size_t n = heap.size();
+	while (true){
+		size_t first = D*i + 1;
+		if (first >= n){
+			break;
+		}
+		size_t last = std::min(first + D, n);
+		size_t smallest = first;
+		for (size_t j=first+1; j<last; ++j){
+			if (heap[j] < heap[smallest]){
+				smallest = j;
+			}
+		}
+		if (!(heap[smallest] < event)){
+			break;
+		}
+		place(i, heap[smallest]);
+		i = smallest;
+	}
+	place(i, event);
+}
+
+//----------------------------------------------------------------------
+void CircleEventQueue::remove(size_t i)
+{
+	/* Detach the event from its arc: */
+	heap[i].site()->data.event = BeachSiteData::NO_EVENT;
+
+	/* Fill the gap with the last element: */
+	CircleEvent last = heap.back();
+	heap.pop_back();
+	if (i == heap.size()){
+		return;
+	}
+	if (i > 0 && last < heap[(i-1) / D]){
+		sift_up(i, last);
+	} else {
+		sift_down(i, last);
+	}
 }
 
 } // NAMESPACE ACOSA
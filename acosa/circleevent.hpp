@@ -23,44 +23,119 @@
  *     http://www.e-lc.org/docs/2011_12_05_14_35_11
  */
 
+#ifndef ACOSA_CIRCLEEVENT_HPP
+#define ACOSA_CIRCLEEVENT_HPP
 
 #include <beach.hpp>
-#include <memory>
+#include <vector>
 
 namespace ACOSA {
 
-class BeachIterator;
-
 //######################################################################
+/*!
+ * \brief A circle event of the sweep.
+ *
+ * The event is a plain value consisting of its latitude and the beach arc
+ * that disappears at it. Its lifetime is managed by the CircleEventQueue.
+ */
 class CircleEvent {
     public:
-	    CircleEvent(const SphereVector& v1, const SphereVector& v2,
-		            const SphereVector& v3, const BeachIterator& it,
-		            double tolerance);
+	    /* Creates the circle event of the nodes i1, i2, and i3 whose
+	     * coordinates are given in the table. The latitude is not
+	     * corrected for rounding errors, but error() bounds them: */
+	    CircleEvent(size_t i1, size_t i2, size_t i3,
+		            const EuclidTable& nodes, BeachSite* site);
 
 		/* This constructor has been created to allow the creation of a
-		 * circle event for the north pole. */
-		CircleEvent(double lat, const BeachIterator& it);
+		 * circle event for the north pole. The error bounds the
+		 * difference of lat to the event's exact latitude. */
+		CircleEvent(double lat, BeachSite* site, double error);
 
 		double lat() const;
 
+		/* Bound of the difference between lat() and the maximum
+		 * latitude of the circle in which the plane through the event's
+		 * nodes cuts the unit sphere, i.e. the circle that is tested
+		 * exactly by circle_top_side: */
+		double error() const;
+
+		BeachSite* site() const;
+
 		bool operator<(const CircleEvent& other) const;
 
 		bool operator>(const CircleEvent& other) const;
 
-		void invalidate();
-		void set_valid();
+	private:
+		double     lat_;
+		double     error_;
+		BeachSite* site_;
+};
 
-		bool valid() const;
 
-		void set_beach_site_iterator(const BeachIterator& iterator);
+/*!
+ * \brief Bound of the difference between the latitude of a node and
+ *        the latitude asin(z) of its Euclidean coordinates in an
+ *        EuclidTable.
+ *
+ * The bound is infinite at the poles.
+ */
+double latitude_error(double lat);
 
-    public:
-		std::shared_ptr<bool> valid_;
-		double                lat_;
-		BeachIterator     beach_site;
+
+//######################################################################
+/*!
+ * \brief The priority queue of circle events.
+ *
+ * An indexed d-ary min-heap of circle events. Each beach arc holds a handle
+ * to its (at most one) circle event, so that events can be removed or
+ * replaced in O(log(n)) instead of being lazily invalidated. The queue hence
+ * never holds more events than there are arcs in the beach.
+ */
+class CircleEventQueue {
+	public:
+		/* Inserts the event. If the event's arc already has a circle event,
+		 * that event is replaced. */
+		void push(const CircleEvent& event);
+
+		/* Removes the circle event of an arc if it has one: */
+		void erase(BeachSite* site);
+
+		/* The circle event of an arc that has one: */
+		const CircleEvent& event(const BeachSite* site) const;
+
+		const CircleEvent& top() const;
+
+		void pop();
+
+		bool empty() const;
+
+		size_t size() const;
+
+		/* Statistics: The number of events pushed, and the number of
+		 * events removed by erase(), pop(), or replacement: */
+		size_t pushed() const;
+
+		size_t removed() const;
+
+	private:
+		constexpr static size_t D = 4;
+
+		std::vector<CircleEvent> heap;
+
+		size_t pushed_ = 0;
+		size_t removed_ = 0;
+
+		void place(size_t i, const CircleEvent& event);
+
+		void sift_up(size_t i, const CircleEvent& event);
+
+		void sift_down(size_t i, const CircleEvent& event);
+
+		void remove(size_t i);
 };
 
 
 
 } // NAMESPACE ACOSA
+
+#endif // ACOSA_CIRCLEEVENT_HPP
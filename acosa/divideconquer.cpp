@@ -0,0 +1,626 @@
+/* Multi-threaded divide-and-conquer Delaunay triangulation on a sphere.
+ * Part of ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <divideconquer.hpp>
+#include <incrementalhull.hpp>
+#include <spherics.hpp>
+#include <geometricgraph.hpp>
+#include <parallel.hpp>
+#include <predicates.hpp>
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+namespace ACOSA {
+
+static constexpr size_t NO_TRIANGLE = std::numeric_limits<size_t>::max();
+
+/* Below this number of nodes, the whole set is triangulated serially: */
+static constexpr size_t MIN_PARALLEL_SIZE = 20000;
+
+/* The targeted number of nodes per cell: */
+static constexpr size_t CELL_SIZE = 20000;
+
+//######################################################################
+
+/* The cells of a cube whose faces are each divided into k x k squares
+ * of the gnomonic projection. Face 2*a+s is the face with normal e_a
+ * (s=0) or -e_a (s=1). On it, u and v are the coordinates (a+1)%3 and
+ * (a+2)%3 divided by the absolute value of coordinate a. */
+class CubeCells {
+	public:
+		CubeCells(size_t k, double margin);
+
+		size_t size() const;
+
+		/* The cell that contains the direction p: */
+		size_t cell(const double p[3]) const;
+
+		/* Appends the cells whose margin may contain the unit vector p.
+		 * This is a superset of the cells whose margin contains it. */
+		void cells_near(const double p[3], std::vector<size_t>& cells) const;
+
+	private:
+		const size_t k;
+		const double sin_margin;
+
+		/* Grid lines of the gnomonic coordinates and 1/sqrt(1+g^2): */
+		std::vector<double> grid;
+		std::vector<double> inv_norm;
+
+		size_t index(double u) const;
+
+		/* Range [first,last) of the grid intervals whose margin may
+		 * contain the direction with gnomonic coordinate c/w, w > 0: */
+		void range(double c, double w, size_t& first, size_t& last) const;
+};
+
+
+//----------------------------------------------------------------------
+CubeCells::CubeCells(size_t k, double margin)
+    : k(k), sin_margin(std::sin(margin)), grid(k+1), inv_norm(k+1)
+{
+	for (size_t i=0; i<=k; ++i){
+		grid[i] = -1.0 + (2.0 * i) / k;
+		inv_norm[i] = 1.0 / std::sqrt(1.0 + grid[i]*grid[i]);
+	}
+}
+
+//----------------------------------------------------------------------
+size_t CubeCells::size() const
+{
+	return 6*k*k;
+}
+
+//----------------------------------------------------------------------
+size_t CubeCells::index(double u) const
+{
+	double t = 0.5 * (u + 1.0) * k;
+	if (t <= 0.0){
+		return 0;
+	}
+	return std::min(static_cast<size_t>(t), k-1);
+}
+
+//----------------------------------------------------------------------
+size_t CubeCells::cell(const double p[3]) const
+{
+	size_t a = 0;
+	for (size_t i=1; i<3; ++i){
+		if (std::abs(p[i]) > std::abs(p[a])){
+			a = i;
+		}
+	}
+	const double w = std::abs(p[a]);
+	const size_t face = 2*a + (p[a] < 0.0);
+	return (face*k + index(p[(a+1) % 3] / w)) * k + index(p[(a+2) % 3] / w);
+}
+
+//----------------------------------------------------------------------
+void CubeCells::range(double c, double w, size_t& first, size_t& last)
+    const
+{
+	/* The interval i is bounded by the great circles through the
+	 * directions with gnomonic coordinates grid[i] and grid[i+1]. The
+	 * signed sine of the distance to them is a dot product with their
+	 * normal vectors: */
+	first = 0;
+	while (first < k &&
+	       (grid[first+1]*w - c) * inv_norm[first+1] < -sin_margin)
+	{
+		++first;
+	}
+	last = k;
+	while (last > first &&
+	       (c - grid[last-1]*w) * inv_norm[last-1] < -sin_margin)
+	{
+		--last;
+	}
+}
+
+//----------------------------------------------------------------------
+void CubeCells::cells_near(const double p[3], std::vector<size_t>& cells)
+    const
+{
+	/* The margin is small enough that it does not reach the half of
+	 * the sphere opposite to a face: */
+	for (size_t a=0; a<3; ++a){
+		for (size_t s=0; s<2; ++s){
+			const double w = (s == 0) ? p[a] : -p[a];
+			if (w <= 0.0){
+				continue;
+			}
+			size_t u0, u1, v0, v1;
+			range(p[(a+1) % 3], w, u0, u1);
+			range(p[(a+2) % 3], w, v0, v1);
+			const size_t face = 2*a + s;
+			for (size_t u=u0; u<u1; ++u){
+				for (size_t v=v0; v<v1; ++v){
+					cells.push_back((face*k + u) * k + v);
+				}
+			}
+		}
+	}
+}
+
+
+//######################################################################
+
+/* The directed links of a set of triangles, grouped by their first
+ * node. */
+struct half_edges_t {
+	half_edges_t(const std::vector<Triangle>& triangles, size_t N);
+
+	/* The triangle containing the directed link i->j, or NO_TRIANGLE: */
+	size_t find(size_t i, size_t j) const;
+
+	std::vector<size_t> offset;
+	std::vector<size_t> target;
+	std::vector<size_t> triangle;
+};
+
+
+//----------------------------------------------------------------------
+half_edges_t::half_edges_t(const std::vector<Triangle>& triangles, size_t N)
+    : offset(N+1, 0), target(3*triangles.size()),
+      triangle(3*triangles.size())
+{
+	for (const Triangle& t : triangles){
+		++offset[t.i+1];
+		++offset[t.j+1];
+		++offset[t.k+1];
+	}
+	for (size_t i=0; i<N; ++i){
+		offset[i+1] += offset[i];
+	}
+	std::vector<size_t> next(offset.begin(), offset.end()-1);
+	for (size_t t=0; t<triangles.size(); ++t){
+		const Triangle& T = triangles[t];
+		const size_t v[3] = {T.i, T.j, T.k};
+		for (int l=0; l<3; ++l){
+			size_t pos = next[v[l]]++;
+			target[pos] = v[(l+1) % 3];
+			triangle[pos] = t;
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+size_t half_edges_t::find(size_t i, size_t j) const
+{
+	for (size_t pos=offset[i]; pos<offset[i+1]; ++pos){
+		if (target[pos] == j){
+			return triangle[pos];
+		}
+	}
+	return NO_TRIANGLE;
+}
+
+
+//######################################################################
+
+/* A directed link u->v of a triangle (u,v,w) whose twin has not been
+ * found in the same triangulation: */
+struct open_link_t {
+	size_t u;
+	size_t v;
+	size_t w;
+
+	bool operator<(const open_link_t& other) const {
+		return u < other.u || (u == other.u && v < other.v);
+	}
+};
+
+/* The result of the triangulation of one cell: */
+struct cell_result_t {
+	std::vector<Triangle> triangles;
+	std::vector<open_link_t> open;
+	double area = 0.0;
+	bool valid = true;
+};
+
+
+//----------------------------------------------------------------------
+static void canonical_rotation(Triangle& t)
+{
+	/* Start with the smallest index, keeping the orientation: */
+	if (t.j < t.i && t.j < t.k){
+		t = Triangle(t.j, t.k, t.i);
+	} else if (t.k < t.i && t.k < t.j){
+		t = Triangle(t.k, t.i, t.j);
+	}
+}
+
+//----------------------------------------------------------------------
+static void canonical_order(std::vector<Triangle>& triangles, size_t N)
+{
+	/* Counting sort by the first index, then sort the few triangles
+	 * sharing it by their second index: */
+	std::vector<size_t> offset(N+1, 0);
+	for (Triangle& t : triangles){
+		canonical_rotation(t);
+		++offset[t.i+1];
+	}
+	for (size_t i=0; i<N; ++i){
+		offset[i+1] += offset[i];
+	}
+	std::vector<Triangle> sorted(triangles.size());
+	std::vector<size_t> next(offset.begin(), offset.end()-1);
+	for (const Triangle& t : triangles){
+		sorted[next[t.i]++] = t;
+	}
+	for (size_t i=0; i<N; ++i){
+		std::sort(sorted.begin()+offset[i], sorted.begin()+offset[i+1],
+		          [](const Triangle& t0, const Triangle& t1){
+		              return t0.j < t1.j;
+		          });
+	}
+	triangles.swap(sorted);
+}
+
+
+//----------------------------------------------------------------------
+static void load(const EuclidTable& table, size_t i, double p[3])
+{
+	p[0] = table.x[i];
+	p[1] = table.y[i];
+	p[2] = table.z[i];
+}
+
+//----------------------------------------------------------------------
+static bool strictly_below(const EuclidTable& table, size_t a, size_t b,
+                           size_t c, size_t d)
+{
+	/* Whether d lies below the plane through a, b, and c (oriented
+	 * counterclockwise seen from above), i.e. outside of the
+	 * circumcircle. Cocircular nodes are not: */
+	double pa[3], pb[3], pc[3], pd[3];
+	load(table, a, pa);
+	load(table, b, pb);
+	load(table, c, pc);
+	load(table, d, pd);
+	return incircle_sphere(pa, pb, pc, pd) < 0.0;
+}
+
+//----------------------------------------------------------------------
+static double signed_area(const EuclidTable& table, const Triangle& t)
+{
+	/* Area of a spherical triangle, negative if it is oriented
+	 * clockwise (Van Oosterom & Strackee): */
+	double a[3], b[3], c[3];
+	load(table, t.i, a);
+	load(table, t.j, b);
+	load(table, t.k, c);
+	double triple =   a[0] * (b[1]*c[2] - b[2]*c[1])
+	                + a[1] * (b[2]*c[0] - b[0]*c[2])
+	                + a[2] * (b[0]*c[1] - b[1]*c[0]);
+	double ab = a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+	double bc = b[0]*c[0] + b[1]*c[1] + b[2]*c[2];
+	double ca = c[0]*a[0] + c[1]*a[1] + c[2]*a[2];
+	return 2.0 * std::atan2(triple, 1.0 + ab + bc + ca);
+}
+
+
+//----------------------------------------------------------------------
+static void triangulate_cell(const EuclidTable& table,
+    const std::vector<size_t>& ids, const CubeCells& cells, size_t cell,
+    double cos_radius, cell_result_t& result)
+{
+	/* Triangulate a local copy of the cell's nodes: */
+	const size_t M = ids.size();
+	if (M < 4){
+		return;
+	}
+	EuclidTable local(table, ids);
+	std::vector<size_t> all(M);
+	for (size_t i=0; i<M; ++i){
+		all[i] = i;
+	}
+	std::vector<Triangle> triangles;
+	try {
+		/* The cells are triangulated in parallel already: */
+		convex_hull_triangles(local, all, triangles, 1);
+	} catch (const std::runtime_error&){
+		/* Leave the cell to the hole filling. */
+		return;
+	}
+
+	/* Certify the triangles whose circumcircle is empty of all nodes.
+	 * Start each with its smallest global index so that the
+	 * circumcenter is computed alike in all cells: */
+	std::vector<char> certified(triangles.size(), false);
+	double pa[3], pb[3], pc[3], n[3];
+	for (size_t t=0; t<triangles.size(); ++t){
+		Triangle& T = triangles[t];
+		if (ids[T.j] < ids[T.i] && ids[T.j] < ids[T.k]){
+			T = Triangle(T.j, T.k, T.i);
+		} else if (ids[T.k] < ids[T.i] && ids[T.k] < ids[T.j]){
+			T = Triangle(T.k, T.i, T.j);
+		}
+		load(local, T.i, pa);
+		load(local, T.j, pb);
+		load(local, T.k, pc);
+		for (int l=0; l<3; ++l){
+			pb[l] -= pa[l];
+			pc[l] -= pa[l];
+		}
+		n[0] = pb[1]*pc[2] - pb[2]*pc[1];
+		n[1] = pb[2]*pc[0] - pb[0]*pc[2];
+		n[2] = pb[0]*pc[1] - pb[1]*pc[0];
+		double norm = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+		double cos_r = n[0]*pa[0] + n[1]*pa[1] + n[2]*pa[2];
+		if (norm > 0.0 && cos_r > cos_radius * norm &&
+		    cells.cell(n) == cell)
+		{
+			certified[t] = true;
+			result.area += signed_area(local, T);
+		}
+	}
+
+	/* Links between two certified triangles are checked here, the
+	 * others are left to the caller: */
+	half_edges_t links(triangles, M);
+	for (size_t t=0; t<triangles.size(); ++t){
+		if (!certified[t]){
+			continue;
+		}
+		const Triangle& T = triangles[t];
+		const size_t v[3] = {T.i, T.j, T.k};
+		for (int l=0; l<3; ++l){
+			size_t a = v[l], b = v[(l+1) % 3], c = v[(l+2) % 3];
+			size_t s = links.find(b, a);
+			if (s == NO_TRIANGLE || !certified[s]){
+				result.open.push_back({ids[a], ids[b], ids[c]});
+			} else if (a < b){
+				const Triangle& S = triangles[s];
+				if (!strictly_below(local, a, b, c, S.i + S.j + S.k - a - b)){
+					result.valid = false;
+					return;
+				}
+			}
+		}
+		result.triangles.emplace_back(ids[T.i], ids[T.j], ids[T.k]);
+	}
+}
+
+
+//----------------------------------------------------------------------
+static bool divide_and_conquer(const EuclidTable& table,
+    std::vector<Triangle>& triangles, unsigned int num_threads)
+{
+	const size_t N = table.x.size();
+
+	/* A margin of three mean node distances. The number of cells
+	 * depends only on N: */
+	const double margin = 3.0 * std::sqrt(4*M_PI / N);
+	const size_t k = std::max<size_t>(1,
+	             std::round(std::sqrt(static_cast<double>(N) / (6*CELL_SIZE))));
+	CubeCells cells(k, margin);
+
+	/* 1) Nodes in each cell and its margin: */
+	typedef std::pair<size_t,size_t> member_t;
+	std::vector<std::vector<member_t>> chunk_members(num_threads);
+	parallel_chunks(N, num_threads,
+	    [&](unsigned int chunk, size_t begin, size_t end){
+		std::vector<size_t> near;
+		double p[3];
+		for (size_t i=begin; i<end; ++i){
+			near.clear();
+			load(table, i, p);
+			cells.cells_near(p, near);
+			for (size_t c : near){
+				chunk_members[chunk].emplace_back(c, i);
+			}
+		}
+	});
+	std::vector<std::vector<size_t>> cell_nodes(cells.size());
+	for (std::vector<member_t>& members : chunk_members){
+		for (const member_t& m : members){
+			cell_nodes[m.first].push_back(m.second);
+		}
+		std::vector<member_t>().swap(members);
+	}
+
+	/* 2) Triangulate each cell. A triangle whose circumcenter lies in
+	 *    the cell and whose circumcircle lies within the margin has no
+	 *    node in its circumcircle, since all nodes there have been
+	 *    part of the cell's triangulation. The circumcircle radius is
+	 *    bounded a little below the margin to absorb rounding errors in
+	 *    the cell membership. */
+	const double cos_radius = std::cos(0.9 * margin);
+	std::vector<cell_result_t> results(cells.size());
+	parallel_for(cells.size(), num_threads, [&](size_t c){
+		triangulate_cell(table, cell_nodes[c], cells, c, cos_radius,
+		                 results[c]);
+		std::vector<size_t>().swap(cell_nodes[c]);
+	});
+
+	double area = 0.0;
+	std::vector<open_link_t> open;
+	for (cell_result_t& r : results){
+		if (!r.valid){
+			return false;
+		}
+		triangles.insert(triangles.end(), r.triangles.begin(),
+		                 r.triangles.end());
+		open.insert(open.end(), r.open.begin(), r.open.end());
+		area += r.area;
+		r = cell_result_t();
+	}
+
+	/* 3) Join the cells at the links between triangles of different
+	 *    cells. The remaining open links border the holes that no cell
+	 *    could certify: */
+	std::sort(open.begin(), open.end());
+	std::vector<open_link_t> border;
+	for (size_t i=0; i<open.size(); ++i){
+		const open_link_t& l = open[i];
+		if (i > 0 && !(open[i-1] < l)){
+			return false;
+		}
+		auto twin = std::lower_bound(open.begin(), open.end(),
+		                             open_link_t({l.v, l.u, 0}));
+		if (twin == open.end() || twin->u != l.v || twin->v != l.u){
+			border.push_back(l);
+		} else if (l.u < l.v &&
+		           !strictly_below(table, l.u, l.v, l.w, twin->w))
+		{
+			return false;
+		}
+	}
+
+	/* 4) Fill the holes. Their Delaunay triangles connect only nodes on
+	 *    their borders and nodes inside, so they are Delaunay triangles
+	 *    of the set of these nodes as well: */
+	std::vector<char> in_hole(N, true);
+	for (const Triangle& t : triangles){
+		in_hole[t.i] = false;
+		in_hole[t.j] = false;
+		in_hole[t.k] = false;
+	}
+	for (const open_link_t& l : border){
+		in_hole[l.u] = true;
+		in_hole[l.v] = true;
+	}
+	std::vector<size_t> hole_nodes;
+	for (size_t i=0; i<N; ++i){
+		if (in_hole[i]){
+			hole_nodes.push_back(i);
+		}
+	}
+	if (!hole_nodes.empty()){
+		if (border.empty()){
+			return false;
+		}
+		for (size_t i=0; hole_nodes.size() < 4; ++i){
+			/* Additional nodes do not change the holes' triangles: */
+			if (!in_hole[i]){
+				hole_nodes.push_back(i);
+			}
+		}
+		std::vector<Triangle> hole_triangles;
+		try {
+			convex_hull_triangles(table, hole_nodes, hole_triangles,
+			                      num_threads);
+		} catch (const std::runtime_error&){
+			return false;
+		}
+
+		/* Collect the triangles reached from the borders without
+		 * crossing them. Each border link has to be met once: */
+		half_edges_t hole_links(hole_triangles, N);
+		std::vector<char> filled(hole_triangles.size(), false);
+		std::vector<size_t> stack;
+		for (const open_link_t& l : border){
+			size_t t = hole_links.find(l.v, l.u);
+			if (t == NO_TRIANGLE){
+				return false;
+			}
+			if (!filled[t]){
+				filled[t] = true;
+				stack.push_back(t);
+			}
+		}
+		size_t border_met = 0;
+		while (!stack.empty()){
+			const Triangle T = hole_triangles[stack.back()];
+			stack.pop_back();
+			triangles.push_back(T);
+			area += signed_area(table, T);
+			const size_t v[3] = {T.i, T.j, T.k};
+			for (int l=0; l<3; ++l){
+				size_t a = v[l], b = v[(l+1) % 3], c = v[(l+2) % 3];
+				auto twin = std::lower_bound(border.begin(), border.end(),
+				                             open_link_t({b, a, 0}));
+				if (twin != border.end() && twin->u == b && twin->v == a){
+					++border_met;
+					if (!strictly_below(table, a, b, c, twin->w)){
+						return false;
+					}
+					continue;
+				}
+				size_t s = hole_links.find(b, a);
+				if (s == NO_TRIANGLE){
+					return false;
+				}
+				const Triangle& S = hole_triangles[s];
+				if (a < b && !strictly_below(table, a, b, c,
+				                             S.i + S.j + S.k - a - b))
+				{
+					return false;
+				}
+				if (!filled[s]){
+					filled[s] = true;
+					stack.push_back(s);
+				}
+			}
+		}
+		if (border_met != border.size()){
+			return false;
+		}
+	} else if (!border.empty()){
+		return false;
+	}
+
+	/* 5) Now every link has its twin, so the triangles cover the sphere
+	 *    an integer number of times. It is once if the areas add up to
+	 *    4pi, and then the triangles form a triangulation of the sphere
+	 *    which is Delaunay at each link. It contains all nodes if it
+	 *    has the right number of triangles: */
+	return triangles.size() == 2*N-4 && std::abs(area - 4*M_PI) < M_PI;
+}
+
+
+//######################################################################
+
+void delaunay_triangulation_parallel(const std::vector<Node>& nodes,
+    std::vector<Triangle>& delaunay_triangles, double tolerance,
+    unsigned int num_threads, bool check_duplicates)
+{
+	/* Sanity check: Make sure that no two nodes are within tolerance of
+	 * each other: */
+	if (check_duplicates){
+		ensure_no_cloned_nodes(nodes, tolerance,
+		                       "delaunay_triangulation_parallel()");
+	}
+
+	num_threads = thread_count(num_threads);
+	const size_t N = nodes.size();
+	EuclidTable table(nodes);
+	delaunay_triangles.clear();
+
+	if (N < MIN_PARALLEL_SIZE ||
+	    !divide_and_conquer(table, delaunay_triangles, num_threads))
+	{
+		/* Triangulate all nodes serially: */
+		std::vector<size_t> ids(N);
+		for (size_t i=0; i<N; ++i){
+			ids[i] = i;
+		}
+		delaunay_triangles.clear();
+		convex_hull_triangles(table, ids, delaunay_triangles,
+		                      num_threads);
+	}
+
+	canonical_order(delaunay_triangles, N);
+}
+
+} // NAMESPACE ACOSA
@@ -0,0 +1,67 @@
+/* Multi-threaded divide-and-conquer Delaunay triangulation on a sphere.
+ * Part of ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACOSA_DIVIDECONQUER_HPP
+#define ACOSA_DIVIDECONQUER_HPP
+
+#include <basic_types.hpp>
+#include <vector>
+
+namespace ACOSA {
+
+/*!
+ * \brief Calculates the Delaunay triangulation of a set of nodes on
+ *        a sphere using multiple threads.
+ * \param nodes Vector of node coordinates. Should not contain any
+ *              duplicates (within tolerance). Otherwise, an
+ *              std::domain_error is thrown.
+ * \param delaunay_triangles Output vector of Delaunay triangles,
+ *                           oriented counterclockwise when seen from
+ *                           outside the sphere.
+ * \param tolerance Tolerance used in the duplicate check.
+ * \param num_threads Number of threads to use. 0 selects the number of
+ *                    hardware threads.
+ * \param check_duplicates If false, the nodes are not checked for
+ *                         duplicates (see
+ *                         delaunay_triangulation_sphere).
+ *
+ * The sphere is divided into the cells of a subdivided cube. The nodes
+ * of each cell and of a margin around it are triangulated independently
+ * by the incremental convex hull algorithm. A triangle is kept if its
+ * circumcenter lies in the cell and its circumcircle within the margin,
+ * which proves it to be a Delaunay triangle of the whole set. The
+ * remaining holes are filled by triangulating the nodes on their
+ * borders.
+ *
+ * The result is verified to be a triangulation of the sphere that is
+ * Delaunay at each link. If the verification fails, or if four nodes
+ * are cocircular so that the triangulation is not unique, the
+ * whole set is triangulated serially instead.
+ *
+ * The triangles are returned in a canonical order: Each starts with
+ * its smallest node index, and they are sorted by their first, then
+ * second index. The result is thus independent of num_threads and of
+ * the path taken.
+ */
+void delaunay_triangulation_parallel(const std::vector<Node>& nodes,
+    std::vector<Triangle>& delaunay_triangles, double tolerance,
+    unsigned int num_threads, bool check_duplicates = true);
+
+} // NAMESPACE ACOSA
+
+#endif // ACOSA_DIVIDECONQUER_HPP
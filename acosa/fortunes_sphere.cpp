@@ -28,10 +28,10 @@
 #include <beach.hpp>
 #include <circleevent.hpp>
 #include <geometricgraph.hpp>
+#include <radixsort.hpp>
+#include <predicates.hpp>
 
 
-#include <queue>
-#include <memory>
 #include <algorithm>
 
 #include <iostream>
@@ -42,7 +42,6 @@
 
 namespace ACOSA {
 
-
 //######################################################################
 
 struct site_event_t {
@@ -50,39 +49,269 @@ struct site_event_t {
 	    : vec(lon, lat), id(id)
 	{}
 
-	bool operator<(const site_event_t& other) const {
-		if (vec.lat() == other.vec.lat()){
-			return vec.lon() < other.vec.lon();
-		}
-		return vec.lat() > other.vec.lat();
-	}
-
 	SphereVector vec;
 	size_t id;
 };
 
 
+/* The buffers of a workspace: */
+struct SweepWorkspace::buffers_t {
+	std::vector<site_event_t> events;
+	std::vector<key_index_t>  order;
+	std::vector<key_index_t>  sort_buffer;
+	EuclidTable               euclid;
+};
+
+//----------------------------------------------------------------------
+SweepWorkspace::SweepWorkspace() : buffers_(new buffers_t())
+{
+}
+
+//----------------------------------------------------------------------
+SweepWorkspace::~SweepWorkspace()
+{
+}
+
+//----------------------------------------------------------------------
+size_t SweepWorkspace::bytes() const
+{
+	const EuclidTable& euclid = buffers_->euclid;
+	return buffers_->events.capacity() * sizeof(site_event_t)
+	    + (buffers_->order.capacity() + buffers_->sort_buffer.capacity())
+	      * sizeof(key_index_t)
+	    + (euclid.x.capacity() + euclid.y.capacity() + euclid.z.capacity()
+	       + euclid.lat.capacity()) * sizeof(double);
+}
+
+//----------------------------------------------------------------------
+SweepWorkspace::buffers_t& SweepWorkspace::buffers()
+{
+	return *buffers_;
+}
+
+
+//######################################################################
+
+/* The site events in order of processing, i.e. sorted by ascending
+ * latitude and, for equal latitude, descending longitude. The events
+ * are sorted once and traversed with a cursor. They are stored in the
+ * buffers of a workspace, which also receives the Euclidean
+ * coordinates of the sites. */
+class SiteEvents {
+	public:
+		SiteEvents(const std::vector<Node>& nodes,
+		           SweepWorkspace::buffers_t& buffers,
+		           unsigned int num_threads);
+
+		const site_event_t& top() const {
+			return events[cursor];
+		}
+
+		void pop() {
+			++cursor;
+		}
+
+		bool empty() const {
+			return cursor == events.size();
+		}
+
+	private:
+		std::vector<site_event_t>& events;
+		size_t cursor = 0;
+};
+
+//----------------------------------------------------------------------
+SiteEvents::SiteEvents(const std::vector<Node>& nodes,
+                       SweepWorkspace::buffers_t& buffers,
+                       unsigned int num_threads)
+    : events(buffers.events)
+{
+	const size_t N = nodes.size();
+	EuclidTable& euclid = buffers.euclid;
+	euclid.assign(nodes);
+
+	/* Sort by longitude (descending) first and then, stably, by
+	 * the Euclidean z (ascending), which is the latitude seen by the
+	 * exact predicates: */
+	std::vector<key_index_t>& order = buffers.order;
+	order.resize(N);
+	for (size_t i=0; i<N; ++i){
+		order[i].key = ~radix_key(nodes[i].lon);
+		order[i].index = i;
+	}
+	radix_sort(order, buffers.sort_buffer, num_threads);
+	for (key_index_t& k : order){
+		k.key = radix_key(euclid.z[k.index]);
+	}
+	radix_sort(order, buffers.sort_buffer, num_threads);
+
+	/* Fill the events. Close to the poles, z resolves the latitude
+	 * only coarsely, so that sites of different latitude may share
+	 * their z. To the predicates, such sites lie on one latitude
+	 * circle. They are hence swept at a common latitude, from which
+	 * their Euclidean coordinates are recomputed: */
+	events.clear();
+	events.reserve(N);
+	double lat = 0.0;
+	for (size_t i=0; i<N; ++i){
+		const size_t id = order[i].index;
+		const Node& node = nodes[id];
+		if (i == 0 || euclid.z[id] != euclid.z[order[i-1].index]){
+			lat = node.lat;
+		} else if (node.lat != lat){
+			double clat = std::cos(lat);
+			euclid.x[id] = std::cos(node.lon)*clat;
+			euclid.y[id] = std::sin(node.lon)*clat;
+			euclid.lat[id] = lat;
+		}
+		events.emplace_back(node.lon, lat, id);
+	}
+}
+
+
+
+//----------------------------------------------------------------------
+static double orientation(const EuclidTable& nodes, size_t i1, size_t i2,
+                          size_t i3)
+{
+	/* Exact sign of det(v1,v2,v3), the dot product of the circumcenter
+	 * -(v1-v2) x (v3-v2) with v1: */
+	const double origin[3] = {0.0, 0.0, 0.0};
+	const double v1[3] = {nodes.x[i1], nodes.y[i1], nodes.z[i1]};
+	const double v2[3] = {nodes.x[i2], nodes.y[i2], nodes.z[i2]};
+	const double v3[3] = {nodes.x[i3], nodes.y[i3], nodes.z[i3]};
+	return orient3d(v1, v2, v3, origin);
+}
 
 //----------------------------------------------------------------------
-static std::shared_ptr<bool> add_circle_event(
-    eventqueue_t& queue, const SphereVector& v1,
-    const SphereVector& v2, const SphereVector& v3, double tide,
-    const BeachIterator& beach_site, double tolerance)
+static void add_circle_event(
+    CircleEventQueue& queue, const EuclidTable& nodes, size_t i1,
+    size_t i2, size_t i3, double tide, double tide_error,
+    BeachIterator& beach_site, const Triangle* removed = nullptr)
 {
-	CircleEvent event(v1, v2, v3, beach_site, tolerance);
-	if (event.lat()+tolerance >= tide){
-		event.set_valid();
+	/* Adds the circle event of the nodes i1, i2, and i3 if it does
+	 * not lie behind the sweep.
+	 * If the nodes include the site of a site event, their circle
+	 * passes through that site and hence its maximum latitude is never
+	 * less than the tide.
+	 * Otherwise, the nodes have become neighbours at the circle event
+	 * of the nodes 'removed', whose left and right nodes they share.
+	 * If the latitude of the new event cannot be separated from the
+	 * tide within the error bounds of both, the four nodes lie
+	 * (nearly) on one circle. The new event
+	 * then coincides with the removed one if the nodes keep their
+	 * cyclic order on that circle, which is decided exactly by the
+	 * orientation of the triangles. */
+	CircleEvent event(i1, i2, i3, nodes, &*beach_site);
+	const double band = event.error() + tide_error;
+	if (removed && event.lat() < tide + band){
+		if (event.lat() < tide - band){
+			return;
+		}
+		double o_new = orientation(nodes, i1, i2, i3);
+		double o_old = orientation(nodes, removed->i, removed->j,
+		                           removed->k);
+		if ((o_new < 0.0 && o_old > 0.0) || (o_new > 0.0 && o_old < 0.0)){
+			return;
+		}
+	}
+
+	/* Never schedule an event behind the sweep. The exact event then
+	 * lies within the shifted error bound: */
+	if (event.lat() < tide){
+		queue.push(CircleEvent(tide, &*beach_site,
+		                       event.error() + (tide - event.lat())));
+	} else {
 		queue.push(event);
-		return event.valid_;
 	}
-	return nullptr;
 }
 
 //----------------------------------------------------------------------
-template<typename site_queue_t>
-static inline Beach init_beach(site_queue_t& site_events,
-                            eventqueue_t& circle_events,
-                            std::vector<Triangle>& delaunay_triangles)
+static bool site_event_first(const site_event_t& site,
+    const CircleEvent& circle, Beach& beach, const EuclidTable& nodes)
+{
+	/* Decide by the latitudes if they differ by more than their error
+	 * bounds. Otherwise, test exactly whether the circle of the event
+	 * reaches above the site. At equal latitude, the circle event comes
+	 * first: */
+	double lat = site.vec.lat();
+	double band = circle.error() + latitude_error(lat);
+	if (lat < circle.lat() - band){
+		return true;
+	} else if (lat > circle.lat() + band){
+		return false;
+	}
+	BeachIterator it(&beach, circle.site(), lat);
+	--it;
+	size_t i1 = it.id();
+	++it;
+	size_t i2 = it.id();
+	++it;
+	size_t i3 = it.id();
+	const double v1[3] = {nodes.x[i1], nodes.y[i1], nodes.z[i1]};
+	const double v2[3] = {nodes.x[i2], nodes.y[i2], nodes.z[i2]};
+	const double v3[3] = {nodes.x[i3], nodes.y[i3], nodes.z[i3]};
+	return circle_top_side(v1, v2, v3, nodes.z[site.id]) > 0.0;
+}
+
+//----------------------------------------------------------------------
+static CircleEvent next_circle_event(CircleEventQueue& queue, Beach& beach,
+    const EuclidTable& nodes)
+{
+	/* The next event is that at the top of the queue, unless the event
+	 * of a neighbouring arc cannot be separated from it within the
+	 * error bounds of both. The two events then share three nodes.
+	 * Since an arc vanishes only if the circle of its event contains no
+	 * node, the event whose circle contains
+	 * the fourth node comes second. This is decided exactly: */
+	CircleEvent event = queue.top();
+	for (size_t step=0; step<beach.size(); ++step){
+		BeachIterator it(&beach, event.site(), event.lat());
+		--it;
+		BeachSite* left = &*it;
+		++it;
+		++it;
+		BeachSite* right = &*it;
+		const bool near_left = left->data.has_circle_event() &&
+		        queue.event(left).lat() < event.lat() + event.error()
+		                                  + queue.event(left).error();
+		const bool near_right = right->data.has_circle_event() &&
+		        queue.event(right).lat() < event.lat() + event.error()
+		                                   + queue.event(right).error();
+		if (!near_left && !near_right)
+			break;
+
+		/* Nodes rr, r, m, l, ll from right to left: */
+		size_t ids[5];
+		++it;
+		for (int i=0; i<5; ++i){
+			ids[i] = it.id();
+			--it;
+		}
+		double v[5][3];
+		for (int i=0; i<5; ++i){
+			v[i][0] = nodes.x[ids[i]];
+			v[i][1] = nodes.y[ids[i]];
+			v[i][2] = nodes.z[ids[i]];
+		}
+		if (near_left && incircle_sphere(v[3], v[2], v[1], v[4]) > 0.0){
+			event = queue.event(left);
+		} else if (near_right &&
+		           incircle_sphere(v[3], v[2], v[1], v[0]) > 0.0)
+		{
+			event = queue.event(right);
+		} else {
+			break;
+		}
+	}
+	queue.erase(event.site());
+	return event;
+}
+
+//----------------------------------------------------------------------
+static inline Beach init_beach(SiteEvents& site_events,
+                               CircleEventQueue& circle_events,
+                               std::vector<Triangle>& delaunay_triangles)
 {
 	/* Step 1): Obtain the first two site events: */
 	site_event_t e1 = site_events.top();
@@ -142,61 +371,39 @@ static inline Beach init_beach(site_queue_t& site_events,
 
 	} else {
 		/* No degeneracy: */
-		return Beach(e1.id, e1.vec, e2.id, e2.vec);
+		return Beach(e1.id, e1.vec, e2.id, e2.vec, circle_events);
 	}
 }
 
-//----------------------------------------------------------------------
-static void ensure_no_cloned_nodes(const std::vector<Node>& nodes,
-                                   double tolerance)
-{
-	std::vector<Link> links;
-	geometric_graph_links(nodes, links, tolerance);
-
-	if (!links.empty()){
-		std::string message("ERROR : delaunay_triangulation_sphere() :\n"
-		                    "Found ");
-		message.append(std::to_string(links.size()))
-		       .append(" node pairs that are equal within tolerance.\n");
-		throw std::domain_error(message);
-	}
-
-}
-
-
 //----------------------------------------------------------------------
 void delaunay_triangulation_sphere(const std::vector<Node>& nodes,
-    std::vector<Triangle>& delaunay_triangles, double tolerance)
+    std::vector<Triangle>& delaunay_triangles, double tolerance,
+    sweep_statistics_t* statistics, SweepWorkspace* workspace,
+    unsigned int num_threads, bool check_duplicates)
 {
-	const size_t N = nodes.size();
-
 	/* 0) Sanity check: Make sure that no two nodes are within tolerance of
 	 *                  each other: */
-	ensure_no_cloned_nodes(nodes, tolerance);
+	if (check_duplicates){
+		ensure_no_cloned_nodes(nodes, tolerance,
+		                       "delaunay_triangulation_sphere()");
+	}
 
 	
-	/* 1) Priority queue of site events. */
-	/*    Site event comparison lambda: */
-	auto cmp_site = 
-	    [](const site_event_t& l, const site_event_t& r)->bool
-		{
-			if (l.vec.lat() == r.vec.lat()){
-				return l.vec.lon() < r.vec.lon();
-			}
-			return l.vec.lat() > r.vec.lat();
-		};
-	/*    1.3: The queue: */
-	std::priority_queue<site_event_t, std::vector<site_event_t>,
-	                    decltype(cmp_site)>
-	    site_events(cmp_site);
-	
-	/*    1.4: Fill the queue: */
-	for (size_t i=0; i<N; ++i){
-		site_events.emplace(nodes[i].lon, nodes[i].lat, i);
+	/* The buffers of the site events and node coordinates: */
+	std::unique_ptr<SweepWorkspace> own_workspace;
+	if (!workspace){
+		own_workspace.reset(new SweepWorkspace());
+		workspace = own_workspace.get();
 	}
+	SweepWorkspace::buffers_t& buffers = workspace->buffers();
+
+	/* 1) Site events, sorted by latitude: */
+	SiteEvents site_events(nodes, buffers, num_threads);
 	
-	/* 2) Priority queue of circle events: */
-	eventqueue_t circle_events;
+	/* 2) Priority queue of circle events, and the Euclidean coordinates
+	 *    of the nodes from which they are calculated: */
+	CircleEventQueue circle_events;
+	const EuclidTable& euclid = buffers.euclid;
 	
 	
 	/* 3) Beach line (ordered): */
@@ -204,20 +411,25 @@ void delaunay_triangulation_sphere(const std::vector<Node>& nodes,
 	                         delaunay_triangles);
 	
 	
+	/* Statistics: */
+	size_t peak_beach_size = beach.size();
+	size_t circle_events_processed = 0;
+
 	/* Now we're ready for the algorithm! */
 	while (!site_events.empty() || !circle_events.empty())
 	{
 		/* Decide whether the next event is a circle event or a site
 		 * event: */
 		if (!site_events.empty() && (circle_events.empty()
-		     || site_events.top().vec.lat() <
-			    circle_events.top().lat()))
+		     || site_event_first(site_events.top(), circle_events.top(),
+		                         beach, euclid)))
 		{
 			/* Site event comes first: */
 			SphereVector vec = site_events.top().vec;
 			size_t       id  = site_events.top().id;
 			site_events.pop();
 			double tide = vec.lat();
+			double tide_error = latitude_error(tide);
 			
 			/* Find iterator where to insert the site event into the
 			 * beach.
@@ -228,14 +440,13 @@ void delaunay_triangulation_sphere(const std::vector<Node>& nodes,
 			 *    site->lon() == it->lon_left()  :  it == p_j
 			 */
 			BeachIterator it = 
-			    beach.find_insert_position(vec.lon(), vec.lat(),
-			                               tolerance);
+			    beach.find_insert_position(vec.lon(), vec.lat());
 			
 			
 			/* Check for degenerate case 
 			 * 			vec.lon() == it->lon_left()
 			 */
-			if (it.lon_left_equal(vec.lon(), tolerance))
+			if (it.lon_left_equal(vec.lon()))
 			{
 				/* Degenerate case. The closest-point-line originating
 				 * from the inserted node (see [1]) meets the arc
@@ -251,18 +462,14 @@ void delaunay_triangulation_sphere(const std::vector<Node>& nodes,
 				/* Obtain beach site attributes.
 				 * Since the site is inserted between two arcs, we can
 				 * sort all relevant arcs into left and right arcs: */
-				SphereVector v_r1 = it.vec();
-				size_t       i_r1 = it.id();
+				size_t i_r1 = it.id();
 				++it; // p_r2
-				SphereVector v_r2 = it.vec();
-				size_t       i_r2 = it.id();
+				size_t i_r2 = it.id();
 				--it; // p_r1
 				--it; // p_l1
-				SphereVector v_l1 = it.vec();
-				size_t       i_l1 = it.id();
+				size_t i_l1 = it.id();
 				--it; // p_l2
-				SphereVector v_l2 = it.vec();
-				size_t       i_l2 = it.id();
+				size_t i_l2 = it.id();
 				++it; // p_l1
 
 				/* Invalidate the current beach event for node p_l1: */
@@ -278,20 +485,14 @@ void delaunay_triangulation_sphere(const std::vector<Node>& nodes,
 
 				/* Check for circle event [p_l2, p_l1, p_i]:  */
 				--it; // p_l1
-				auto ce = add_circle_event(circle_events, v_l2, v_l1, vec,
-				                           tide, it, tolerance);
-				if (ce){
-					beach.register_circle_event(it, ce);
-				}
+				add_circle_event(circle_events, euclid, i_l2, i_l1, id,
+				                 tide, tide_error, it);
 
 				/* Check for circle event [p_i, p_r1, p_r2]: */
 				++it; // p_i
 				++it; // p_r1
-				ce = add_circle_event(circle_events, vec, v_r1, v_r2,
-				                      tide, it, tolerance);
-				if (ce){
-					beach.register_circle_event(it, ce);
-				}
+				add_circle_event(circle_events, euclid, id, i_r1, i_r2,
+				                 tide, tide_error, it);
 
 				/* Finally, create Delaunay triangle: */
 				delaunay_triangles.emplace_back(id, i_l1, i_r1);
@@ -302,13 +503,11 @@ void delaunay_triangulation_sphere(const std::vector<Node>& nodes,
 				
 				/* Obtain beach site attributes. Notation follows [1].
 				 * After the search, we have it == p_3: */
-				SphereVector v_3 = it.vec();
 				size_t       i_3 = it.id();
 				--it; // p_j
 				SphereVector v_j = it.vec();
 				size_t       i_j = it.id();
 				--it; // p_2
-				SphereVector v_2 = it.vec();
 				size_t       i_2 = it.id();
 				++it; // p_j          
 				
@@ -324,78 +523,80 @@ void delaunay_triangulation_sphere(const std::vector<Node>& nodes,
 				     
 				/* Update the circle event for the split-off node v_j
 				 * if it exists ( [p_2, p_j, pi] ). */
-				auto ce = add_circle_event(circle_events, v_2, v_j, vec,
-				                           tide, it, tolerance);
-				if (ce){
-					beach.register_circle_event(it, ce);
-				}
+				add_circle_event(circle_events, euclid, i_2, i_j, id,
+				                 tide, tide_error, it);
 				
 				/* Update the circle event for the current node v_j
 				 * if it exists ( [p_i, p_j, p3] ): */
 				++it;
 				++it;
-				ce = add_circle_event(circle_events, vec, v_j, v_3,
-				                           tide, it, tolerance);
-				if (ce){
-					beach.register_circle_event(it, ce);
-				}
+				add_circle_event(circle_events, euclid, id, i_j, i_3,
+				                 tide, tide_error, it);
 			}
-			
+			peak_beach_size = std::max(peak_beach_size, beach.size());
 			
 			
 		} else {
 			/* Circle event comes first: */
-			CircleEvent event = circle_events.top();
-			circle_events.pop();
-			if (!event.valid()){
-				continue;
-			}
+			CircleEvent event = next_circle_event(circle_events, beach,
+			                                      euclid);
 			
-			/* Valid event. Remove it from beach.
+			/* Remove the event's arc from beach.
 			 * This will also invalidate circle events of the
 			 * neighbouring nodes that contain it and update 
 			 * its right neighbour's left-vector: */
-			BeachIterator it = event.beach_site;
-			size_t        id = it.id();
 			double      tide = event.lat();
+			double      tide_error = event.error();
+			if (!site_events.empty() &&
+			    site_events.top().vec.lat() < tide)
+			{
+				tide = site_events.top().vec.lat();
+				tide_error = latitude_error(tide);
+			}
+			BeachIterator it(&beach, event.site(), tide);
+			size_t        id = it.id();
 
-			beach.set_tide(it.tide());
+			beach.set_tide(tide);
 			it = beach.erase(it);
 			
 			/* Left and right neighbours of removed node: */
-			ArcIntersect r = it->first;
+			size_t i_r = it.id();
 			--it;
-			ArcIntersect l = it->first;
+			size_t i_l = it.id();
 			
+			/* The Delaunay triangle of the event: */
+			Triangle removed(i_l, id, i_r);
+
 			if (beach.size() > 2){
 				/* Check left circle event: */
-				auto ce = add_circle_event(circle_events, l.left(), 
-				                           l.vec(),
-				                           r.vec(), tide, it,
-				                           tolerance);
-				if (ce){
-					beach.register_circle_event(it, ce);
-				}
+				--it;
+				size_t i_ll = it.id();
+				++it;
+				add_circle_event(circle_events, euclid, i_ll, i_l, i_r,
+				                 tide, tide_error, it, &removed);
 				
 				/* Check right circle event: */
 				++it;
 				++it;
-				ArcIntersect rr = it->first;
+				size_t i_rr = it.id();
 				--it;
-				ce = add_circle_event(circle_events, r.left(), 
-				                      r.vec(),
-				                      rr.vec(), tide, it,
-				                      tolerance);
-				if (ce){
-					beach.register_circle_event(it, ce);
-				}
+				add_circle_event(circle_events, euclid, i_l, i_r, i_rr,
+				                 tide, tide_error, it, &removed);
 			}
 			
-			/* Valid event. Create Delaunay triangle: */
-			delaunay_triangles.emplace_back(l.id(), id, r.id());
-			
+			/* Create Delaunay triangle: */
+			delaunay_triangles.push_back(removed);
+			++circle_events_processed;
 		}
 	}
+
+	if (statistics){
+		statistics->peak_beach_size = peak_beach_size;
+		statistics->circle_events_pushed = circle_events.pushed();
+		statistics->circle_events_invalidated = circle_events.removed()
+		                                        - circle_events_processed;
+		statistics->circle_events_processed = circle_events_processed;
+	}
 }
 
 
@@ -31,9 +31,53 @@
 
 #include <basic_types.hpp>
 #include <vector>
+#include <memory>
 
 namespace ACOSA {
 
+/*!
+ * \brief Statistics of a run of the sweepline algorithm.
+ */
+struct sweep_statistics_t {
+	/*! \brief Maximum number of arcs in the beach. */
+	size_t peak_beach_size;
+
+	/*! \brief Number of circle events added to the queue, including
+	 *         those that replaced an arc's previous event. */
+	size_t circle_events_pushed;
+
+	/*! \brief Number of circle events that were removed or replaced
+	 *         before they were reached by the sweep. */
+	size_t circle_events_invalidated;
+
+	/*! \brief Number of circle events processed by the sweep. */
+	size_t circle_events_processed;
+};
+
+
+/*!
+ * \brief Buffers of the sweepline algorithm that are kept between
+ *        several runs, so that they need not be allocated again.
+ */
+class SweepWorkspace {
+	public:
+		SweepWorkspace();
+
+		~SweepWorkspace();
+
+		/* Memory held by the buffers: */
+		size_t bytes() const;
+
+		/* The buffers, defined by the sweepline algorithm: */
+		struct buffers_t;
+
+		buffers_t& buffers();
+
+	private:
+		std::unique_ptr<buffers_t> buffers_;
+};
+
+
 /* Methods: */
 
 
@@ -44,24 +88,34 @@ namespace ACOSA {
  *              duplicates (within tolerance). Otherwise, an
  *              std::domain_error is thrown.
  * \param delaunay_triangles Output vector of Delaunay triangles.
- * \param tolerance A tolerance to account for numerical errors when
- *                  calculating the geometric points. This parameter
- *                  is crucial especially for regular grids, where
- *                  rounding error may lead to chaotic behaviour
- *                  if tolerance is too low.
- *                  Random node sets are, empirically more resistant
- *                  to lower tolerance
+ * \param tolerance Minimum distance between two nodes that are not
+ *                  duplicates.
+ * \param statistics If not null, the statistics of the sweep are
+ *                   written to it.
+ * \param workspace If not null, the buffers of the sweep are taken
+ *                  from and kept in the workspace.
+ * \param num_threads Number of threads used to sort the site events.
+ *                    0 selects the number of hardware threads. The
+ *                    sweep itself runs in the calling thread.
+ * \param check_duplicates If false, the nodes are assumed to contain
+ *                         no duplicates, e.g. since they have been
+ *                         merged by merge_cloned_nodes, and are not
+ *                         checked.
  * 
  * The code is an implementation of the plane sweep Voronoi algorithm
  * described in [1]. It has complexity O(N*log(N)).
  *
- * The tolerance parameter is used when determining whether a circle
- * event is above or below the sweepline. If no tolerance is used,
- * numerical errors may falsify the results, especially for regular
- * grids where circle events may coincide with the sweepline.
+ * Whether a circle event lies above or below the sweepline is decided
+ * by the latitudes if they differ by more than their rounding error
+ * bounds, and by exact predicates otherwise. This matters especially
+ * for regular grids where circle events may coincide with the
+ * sweepline.
  * */
 void delaunay_triangulation_sphere(const std::vector<Node>& nodes,
-    std::vector<Triangle>& delaunay_triangles, double tolerance);
+    std::vector<Triangle>& delaunay_triangles, double tolerance,
+    sweep_statistics_t* statistics = nullptr,
+    SweepWorkspace* workspace = nullptr,
+    unsigned int num_threads = 0, bool check_duplicates = true);
 
 } // NAMESPACE ACOSA
 
@@ -25,11 +25,15 @@
 
 
 #include <geometricgraph.hpp>
+#include <parallel.hpp>
 
 #include <queue>
 #include <set>
 #include <cmath>
 #include <algorithm>
+#include <string>
+#include <stdexcept>
+#include <limits>
 
 
 namespace ACOSA {
@@ -58,30 +62,93 @@ static double greatcircle_distance(double sin_dlon, double cos_dlon,
 
 
 
-/* A struct to hold both coordinates and id of a node. */
+/* A struct to hold coordinates, unit vector and id of a node. */
 struct node_t {
 	size_t id;
 	double lon;
 	double lat;
+	double x;
+	double y;
+	double z;
+
+	node_t(size_t id, const Node& node);
+};
+
+//----------------------------------------------------------------------
+node_t::node_t(size_t id, const Node& node)
+    : id(id), lon(node.lon), lat(node.lat)
+{
+	const double clat = std::cos(lat);
+	x = clat * std::cos(lon);
+	y = clat * std::sin(lon);
+	z = std::sin(lat);
+}
+
+
+/* The connection threshold. Two nodes are connected if the dot product
+ * of their unit vectors exceeds cos(sigma_0), which is decided by a few
+ * multiply-adds. Only within a margin that covers the rounding errors of
+ * the dot product, the great circle distance is computed: */
+struct threshold_t {
+	double sigma_0;
+	double cos_upper;
+	double cos_lower;
+
+	threshold_t(double sigma_0);
+
+	bool connects(const node_t& a, const node_t& b) const;
 };
 
+//----------------------------------------------------------------------
+threshold_t::threshold_t(double sigma_0) : sigma_0(sigma_0)
+{
+	/* The cosine is monotonous only in [0,pi]. Beyond, no or all nodes
+	 * are connected: */
+	double cos_sigma_0 = std::cos(sigma_0);
+	if (sigma_0 <= 0.0){
+		cos_sigma_0 = 2.0;
+	} else if (sigma_0 > M_PI){
+		cos_sigma_0 = -2.0;
+	}
+
+	/* The unit vectors and their dot product are accurate to a few
+	 * ulp, so this margin is safe: */
+	constexpr double margin = 1e-14;
+	cos_upper = cos_sigma_0 + margin;
+	cos_lower = cos_sigma_0 - margin;
+}
+
+//----------------------------------------------------------------------
+inline bool threshold_t::connects(const node_t& a, const node_t& b) const
+{
+	const double dot = a.x*b.x + a.y*b.y + a.z*b.z;
+	if (dot > cos_upper)
+		return true;
+	if (dot < cos_lower)
+		return false;
+
+	/* Near the threshold. The rounding of the distance depends on the
+	 * order of the nodes, so that they are ordered by id to decide
+	 * equally if the pair is tested from either node: */
+	const node_t& c = (a.id < b.id) ? a : b;
+	const node_t& d = (a.id < b.id) ? b : a;
+	return greatcircle_distance(std::sin(c.lon-d.lon), std::cos(c.lon-d.lon),
+	                            std::sin(c.lat), std::cos(c.lat),
+	                            std::sin(d.lat), std::cos(d.lat))
+	       < sigma_0;
+}
+
 
 
 static void geometric_graph_links_pairwise(
     const std::vector<node_t>::const_iterator& begin,
     const std::vector<node_t>::const_iterator& end,
     std::vector<Link>& links,
-    double sigma_0)
+    const threshold_t& threshold)
 {
 	for (auto it=begin; it!=end; ++it){
-		double slat_1 = std::sin(it->lat);
-		double clat_1 = std::cos(it->lat);
 		for (auto it2=it+1; it2 != end; ++it2){
-			if (greatcircle_distance(std::sin(it->lon-it2->lon),
-			                         std::cos(it->lon-it2->lon),
-			                         slat_1, clat_1, std::sin(it2->lat),
-			                         std::cos(it2->lat))
-			    < sigma_0)
+			if (threshold.connects(*it, *it2))
 			{
 				links.push_back({it->id, it2->id});
 				links.push_back({it2->id, it->id});
@@ -92,12 +159,224 @@ static void geometric_graph_links_pairwise(
 
 
 
-void geometric_graph_links(
+/* Nodes sorted into buckets, stored contiguously: The sphere is split
+ * into latitude bands whose height is at least sigma_0/2, and each band
+ * into longitude intervals of about the same length at its center, so
+ * that the buckets have roughly equal area. A node's neighbours lie in
+ * its own and the bands within reach of sigma_0, within the longitude
+ * interval of its sigma_0 circle. */
+class BucketGrid {
+	public:
+		BucketGrid(const std::vector<Node>& coordinates, double sigma_0);
+
+		/* Number of nodes: */
+		size_t size() const;
+
+		/* The node at position p of the grid: */
+		const node_t& node(size_t p) const;
+
+		/* Call visit(a,b) once for each pair of connected nodes in
+		 * which a is one of the nodes at positions [begin,end) of the
+		 * grid and b follows a in the grid: */
+		template<typename visitor_t>
+		void connected_pairs(const threshold_t& threshold, size_t begin,
+		                     size_t end, visitor_t&& visit) const;
+
+		/* Call visit(b) for each node b connected to the node at
+		 * position p of the grid: */
+		template<typename visitor_t>
+		void neighbours(const threshold_t& threshold, size_t p,
+		                visitor_t&& visit) const;
+
+	private:
+		double sigma_0;
+		double sin_sigma_0;
+		double band_height;
+		size_t band_reach;
+
+		/* First bucket of each band, and the number of buckets and
+		 * their longitude width in each band: */
+		std::vector<size_t> band_first;
+		std::vector<size_t> band_buckets;
+		std::vector<double> band_width;
+
+		/* First node of each bucket and the nodes: */
+		std::vector<size_t> bucket_first;
+		std::vector<node_t> nodes;
+
+		size_t band(double lat) const;
+
+		/* Call visit(b) for the nodes b connected to the node at
+		 * position p, either for all or only for those following it: */
+		template<typename visitor_t>
+		void scan(const threshold_t& threshold, size_t p, bool following,
+		          visitor_t&& visit) const;
+};
+
+//----------------------------------------------------------------------
+BucketGrid::BucketGrid(const std::vector<Node>& coordinates,
+                       double sigma_0)
+    : sigma_0(sigma_0), sin_sigma_0(std::sin(sigma_0))
+{
+	const size_t N = coordinates.size();
+
+	/* Buckets of half of sigma_0 cut the area searched around a node
+	 * compared to buckets of sigma_0. To limit the memory, there are
+	 * about as many buckets as nodes at most. The bands are a little
+	 * higher than the bucket size, so that rounding cannot place
+	 * neighbours farther apart than band_reach: */
+	const double size = std::max(0.5 * sigma_0,
+	                             std::sqrt(4.0*M_PI / std::max<size_t>(N,1)));
+	const size_t n_bands = std::max<size_t>(
+	                 std::floor(M_PI / size * (1.0 - 1e-9)), 1);
+	band_height = M_PI / n_bands;
+	band_reach = std::max<size_t>(std::ceil(sigma_0 / band_height), 1);
+
+	band_first.resize(n_bands+1);
+	band_buckets.resize(n_bands);
+	band_width.resize(n_bands);
+	size_t buckets = 0;
+	for (size_t b=0; b<n_bands; ++b){
+		const double center = (b + 0.5) * band_height - M_PI_2;
+		band_buckets[b] = std::max<size_t>(
+		             std::floor(2.0 * M_PI * std::cos(center) / size), 1);
+		band_width[b] = 2.0 * M_PI / band_buckets[b];
+		band_first[b] = buckets;
+		buckets += band_buckets[b];
+	}
+	band_first[n_bands] = buckets;
+
+	/* Sort the nodes into the buckets, keeping their order within each
+	 * bucket: */
+	std::vector<size_t> bucket_of(N);
+	bucket_first.assign(buckets+1, 0);
+	for (size_t i=0; i<N; ++i){
+		const size_t b = band(coordinates[i].lat);
+		const size_t k = std::min<size_t>(coordinates[i].lon / band_width[b],
+		                                  band_buckets[b] - 1);
+		bucket_of[i] = band_first[b] + k;
+		++bucket_first[bucket_of[i]+1];
+	}
+	for (size_t k=0; k<buckets; ++k){
+		bucket_first[k+1] += bucket_first[k];
+	}
+	std::vector<size_t> position(bucket_first.begin(),
+	                             bucket_first.end() - 1);
+	std::vector<size_t> order(N);
+	for (size_t i=0; i<N; ++i){
+		order[position[bucket_of[i]]++] = i;
+	}
+	nodes.reserve(N);
+	for (size_t i : order){
+		nodes.emplace_back(i, coordinates[i]);
+	}
+}
+
+//----------------------------------------------------------------------
+size_t BucketGrid::size() const
+{
+	return nodes.size();
+}
+
+//----------------------------------------------------------------------
+size_t BucketGrid::band(double lat) const
+{
+	const double b = std::floor((lat + M_PI_2) / band_height);
+	if (!(b > 0.0))
+		return 0;
+	return std::min<size_t>(b, band_buckets.size() - 1);
+}
+
+//----------------------------------------------------------------------
+const node_t& BucketGrid::node(size_t p) const
+{
+	return nodes[p];
+}
+
+//----------------------------------------------------------------------
+template<typename visitor_t>
+void BucketGrid::connected_pairs(const threshold_t& threshold,
+    size_t begin, size_t end, visitor_t&& visit) const
+{
+	for (size_t p=begin; p<end; ++p){
+		const node_t& a = nodes[p];
+		scan(threshold, p, true, [&](const node_t& b){
+			visit(a, b);
+		});
+	}
+}
+
+//----------------------------------------------------------------------
+template<typename visitor_t>
+void BucketGrid::neighbours(const threshold_t& threshold, size_t p,
+    visitor_t&& visit) const
+{
+	scan(threshold, p, false, visit);
+}
+
+//----------------------------------------------------------------------
+template<typename visitor_t>
+void BucketGrid::scan(const threshold_t& threshold, size_t p,
+    bool following, visitor_t&& visit) const
+{
+	const node_t& node = nodes[p];
+
+	/* Half the longitude interval of the node's sigma_0 circle (see
+	 * geometric_graph_links_sweep), widened against rounding. If the
+	 * circle contains a pole, all longitudes are searched: */
+	double delta_lon = M_PI;
+	if (sigma_0 < M_PI_2){
+		const double s = sin_sigma_0 / std::cos(node.lat);
+		if (s < 1.0)
+			delta_lon = std::asin(s) + 1e-9;
+	}
+	const double lon = node.lon;
+
+	/* Nodes in lower bands precede the node in the grid: */
+	const size_t b0 = band(node.lat);
+	const size_t b_begin = following ? b0
+	                       : (b0 < band_reach ? 0 : b0 - band_reach);
+	const size_t b_end = std::min(b0 + band_reach + 1, band_buckets.size());
+	for (size_t b=b_begin; b<b_end; ++b){
+		const long n = band_buckets[b];
+		long k_lo = std::floor((lon - delta_lon) / band_width[b]);
+		long k_hi = std::floor((lon + delta_lon) / band_width[b]);
+		if (k_hi - k_lo + 1 >= n){
+			k_lo = 0;
+			k_hi = n - 1;
+		}
+		for (long k=k_lo; k<=k_hi; ++k){
+			const size_t bucket = band_first[b] + ((k % n) + n) % n;
+			const size_t first = following
+			                     ? std::max(bucket_first[bucket], p+1)
+			                     : bucket_first[bucket];
+			for (size_t q=first; q<bucket_first[bucket+1]; ++q){
+				if (q != p && threshold.connects(node, nodes[q]))
+					visit(nodes[q]);
+			}
+		}
+	}
+}
+
+
+
+/* Number of grid positions that a thread processes at a time: */
+constexpr size_t BLOCK_SIZE = 4096;
+
+
+
+static void geometric_graph_links_sweep(
     const std::vector<Node>& coordinates,
     std::vector<Link>& links,
-    double sigma_0)
+    const threshold_t& threshold)
 {
 	const size_t N = coordinates.size();
+	const double sigma_0 = threshold.sigma_0;
+	std::vector<node_t> nodes;
+	nodes.reserve(N);
+	for (size_t i=0; i<N; ++i){
+		nodes.emplace_back(i, coordinates[i]);
+	}
 
 	/* If N is small or sigma_0 is big, there is no advantage of the
 	 * more complicated algorithm, so we can take a simple pairwise
@@ -108,30 +387,8 @@ void geometric_graph_links(
 	 * to limit the longitude interval in which to search). */
 	constexpr double sigma_limit = std::min(M_PI_2, 17.0/180.0 * M_PI);
 	if (N <= 100 || sigma_0 > sigma_limit){
-		struct coord_trigf_t{
-			double sin_lat;
-			double cos_lat;
-		};
-		std::vector<coord_trigf_t> vec(N);
-		for (size_t i=0; i<N; ++i){
-			vec[i].sin_lat = std::sin(coordinates[i].lat);
-			vec[i].cos_lat = std::cos(coordinates[i].lat);
-		}
-
-		for (size_t i=0; i<N; ++i){
-			for (size_t j=i+1; j<N; ++j){
-				double dlon = coordinates[i].lon - coordinates[j].lon;
-				if (greatcircle_distance(std::sin(dlon), std::cos(dlon),
-				                         vec[i].sin_lat, vec[i].cos_lat,
-				                         vec[j].sin_lat, vec[j].cos_lat)
-				    < sigma_0)
-				{
-					links.push_back({i, j});
-					links.push_back({j, i});
-				}
-			}
-		}
-
+		geometric_graph_links_pairwise(nodes.cbegin(), nodes.cend(), links,
+		                               threshold);
 		return;
 	}
 
@@ -143,12 +400,6 @@ void geometric_graph_links(
 		    return l.lat < r.lat;
 	    };
 
-	std::vector<node_t> nodes(N);
-
-	for (size_t i=0; i<N; ++i){
-		nodes[i] = {i, coordinates[i].lon, coordinates[i].lat};
-	}
-
 	std::sort<std::vector<node_t>::iterator,decltype(cmp_lat)>(
 	    nodes.begin(), nodes.end(), cmp_lat);
 
@@ -178,7 +429,7 @@ void geometric_graph_links(
 	}
 
 	geometric_graph_links_pairwise(nodes.begin(),
-	    enter, links, sigma_0);
+	    enter, links, threshold);
 
 
 	/* Step 2: Use belt for most of the other nodes: */
@@ -189,6 +440,15 @@ void geometric_graph_links(
 		if (leave_events.empty() ||
 		    enter->lat <= (*leave_events.front())->lat+sigma_0)
 		{
+			if (enter->lat >= M_PI_2 - sigma_0){
+				/* We entered the arctic. Cool stuff!
+				 * Now for science and stuff, we mark the arctic's
+				 * border. Its nodes are connected to the belt in
+				 * step 3: */
+				arctic_begin = enter;
+				break;
+			}
+
 			/* Connect to nodes in belt.
 			 * First we determine the longitude bounds in which we have
 			 * to search the belt: */
@@ -228,8 +488,6 @@ void geometric_graph_links(
 			if (!belt.empty()){
 				/* Now iterate to left and right from insertion position,
 				 * checking all nodes inside the longitude bounds: */
-				double slat_1 = std::sin(enter->lat);
-				double clat_1 = std::cos(enter->lat);
 
 				/* Iterate to left: */
 				auto it = insert_pos;
@@ -240,13 +498,7 @@ void geometric_graph_links(
 					 * then continue as usual: */
 					while (it != belt.begin()){
 						--it;
-						if (greatcircle_distance(
-						        std::sin(enter->lon-(*it)->lon),
-						        std::cos(enter->lon-(*it)->lon),
-						        slat_1, clat_1,
-						        std::sin((*it)->lat),
-						        std::cos((*it)->lat))
-						    < sigma_0)
+						if (threshold.connects(*enter, **it))
 						{
 							links.push_back({(*it)->id, enter->id});
 							links.push_back({enter->id, (*it)->id});
@@ -263,12 +515,7 @@ void geometric_graph_links(
 				/* Iterate until we reach the longitude border: */
 				while (it != belt.begin() && (*(--it))->lon >= lon_left)
 				{
-					if (greatcircle_distance(std::sin(enter->lon-(*it)->lon),
-					                         std::cos(enter->lon-(*it)->lon),
-					                         slat_1, clat_1,
-					                         std::sin((*it)->lat),
-					                         std::cos((*it)->lat))
-					    < sigma_0)
+					if (threshold.connects(*enter, **it))
 					{
 						links.push_back({(*it)->id, enter->id});
 						links.push_back({enter->id, (*it)->id});
@@ -286,13 +533,7 @@ void geometric_graph_links(
 					 * over all nodes up to that border, wrap around and
 					 * then continue as usual: */
 					while (it != belt.end()){
-						if (greatcircle_distance(
-						        std::sin(enter->lon-(*it)->lon),
-						        std::cos(enter->lon-(*it)->lon),
-						        slat_1, clat_1,
-						        std::sin((*it)->lat),
-						        std::cos((*it)->lat))
-						    < sigma_0)
+						if (threshold.connects(*enter, **it))
 						{
 							links.push_back({(*it)->id, enter->id});
 							links.push_back({enter->id, (*it)->id});
@@ -306,12 +547,7 @@ void geometric_graph_links(
 
 				/* Iterate until we reach the longitude border: */
 				while (it != belt.end() && (*it)->lon <= lon_right){
-					if (greatcircle_distance(std::sin(enter->lon-(*it)->lon),
-					                         std::cos(enter->lon-(*it)->lon),
-					                         slat_1, clat_1,
-					                         std::sin((*it)->lat),
-					                         std::cos((*it)->lat))
-					    < sigma_0)
+					if (threshold.connects(*enter, **it))
 					{
 						links.push_back({(*it)->id, enter->id});
 						links.push_back({enter->id, (*it)->id});
@@ -320,17 +556,8 @@ void geometric_graph_links(
 				}
 			}
 
-			/* Insert node into belt, if it is not part of the arctic: */
-			if (enter->lat < M_PI_2 - sigma_0){
-				/* Inset to belt: */
-				leave_events.push(belt.insert(&*enter).first);
-			} else {
-				/* We entered the arctic. Cool stuff!
-				 * Now for science and stuff, we mark the arctic's
-				 * border: */
-				arctic_begin = enter;
-				break;
-			}
+			/* Insert node into belt: */
+			leave_events.push(belt.insert(&*enter).first);
 
 			++enter;
 		} else {
@@ -345,16 +572,8 @@ void geometric_graph_links(
 	/* Step 3: Connect the remaining nodes of the belt to all its
 	 *         remaining neighbours: */
 	for (const node_t* node : belt){
-		double slat_1 = std::sin(node->lat);
-		double clat_1 = std::cos(node->lat);
-
 		for (auto it = arctic_begin; it != nodes.end(); ++it){
-			if (greatcircle_distance(std::sin(node->lon-it->lon),
-			                         std::cos(node->lon-it->lon),
-			                         slat_1, clat_1,
-			                         std::sin(it->lat),
-			                         std::cos(it->lat))
-			    < sigma_0)
+			if (threshold.connects(*node, *it))
 			{
 				links.push_back({it->id, node->id});
 				links.push_back({node->id, it->id});
@@ -366,9 +585,530 @@ void geometric_graph_links(
 	/* Step 4: Connect all nodes inside the arctic (the north pole's
 	 *         sigma_0 circle): */
 	geometric_graph_links_pairwise(arctic_begin,
-	    nodes.end(), links, sigma_0);
+	    nodes.end(), links, threshold);
 
 	/* Et voila, we're done! */
 }
 
+
+
+void geometric_graph_links(
+    const std::vector<Node>& coordinates,
+    std::vector<Link>& links,
+    double sigma_0,
+    geometric_graph_algorithm_t algorithm,
+    unsigned int num_threads)
+{
+	const threshold_t threshold(sigma_0);
+	if (algorithm == GEOMETRIC_GRAPH_SWEEP){
+		geometric_graph_links_sweep(coordinates, links, threshold);
+		return;
+	}
+
+	/* No node pair is closer than a non-positive threshold: */
+	if (!(sigma_0 > 0.0))
+		return;
+
+	const BucketGrid grid(coordinates, sigma_0);
+
+	/* The grid is split into blocks of nodes, which are handed out to
+	 * the threads one at a time since their cost varies. Each block's
+	 * links are collected separately and appended in order, so that
+	 * the result equals that of a single thread: */
+	const size_t n_blocks = (grid.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	num_threads = std::min<size_t>(thread_count(num_threads), n_blocks);
+	if (num_threads <= 1){
+		grid.connected_pairs(threshold, 0, grid.size(),
+		    [&](const node_t& a, const node_t& b){
+			links.push_back({a.id, b.id});
+			links.push_back({b.id, a.id});
+		});
+		return;
+	}
+
+	std::vector<std::vector<Link>> block_links(n_blocks);
+	parallel_for(n_blocks, num_threads, [&](size_t block){
+		std::vector<Link>& target = block_links[block];
+		grid.connected_pairs(threshold, block * BLOCK_SIZE,
+		    std::min((block+1) * BLOCK_SIZE, grid.size()),
+		    [&](const node_t& a, const node_t& b){
+			target.push_back({a.id, b.id});
+			target.push_back({b.id, a.id});
+		});
+	});
+
+	/* Append the blocks, releasing each once it has been copied: */
+	std::vector<size_t> offset(n_blocks+1, links.size());
+	for (size_t block=0; block<n_blocks; ++block){
+		offset[block+1] = offset[block] + block_links[block].size();
+	}
+	links.resize(offset[n_blocks]);
+	parallel_chunks(n_blocks, num_threads,
+	    [&](unsigned int, size_t begin, size_t end){
+		for (size_t block=begin; block<end; ++block){
+			std::copy(block_links[block].begin(), block_links[block].end(),
+			          links.begin() + offset[block]);
+			std::vector<Link>().swap(block_links[block]);
+		}
+	});
+}
+
+
+
+//----------------------------------------------------------------------
+static double great_circle_distance(const node_t& a, const node_t& b)
+{
+	/* Well-conditioned for all distances: */
+	const double cx = a.y*b.z - a.z*b.y;
+	const double cy = a.z*b.x - a.x*b.z;
+	const double cz = a.x*b.y - a.y*b.x;
+	return std::atan2(std::sqrt(cx*cx + cy*cy + cz*cz),
+	                  a.x*b.x + a.y*b.y + a.z*b.z);
+}
+
+//----------------------------------------------------------------------
+template<typename T>
+static void merge_runs(std::vector<T>& data, std::vector<size_t>& runs,
+                       std::vector<T>& buffer)
+{
+	/* Sort data consisting of ascending runs, given by their starts
+	 * followed by data.size(), by merging pairs of adjacent runs: */
+	buffer.resize(data.size());
+	while (runs.size() > 2){
+		const size_t n_runs = runs.size() - 1;
+		size_t merged = 0;
+		for (size_t r=0; r<n_runs; r+=2){
+			const auto begin = data.begin() + runs[r];
+			const auto mid = data.begin() + runs[r+1];
+			const auto end = data.begin() + runs[std::min(r+2, n_runs)];
+			std::merge(begin, mid, mid, end, buffer.begin() + runs[r]);
+			runs[merged++] = runs[r];
+		}
+		runs[merged++] = data.size();
+		runs.resize(merged);
+		data.swap(buffer);
+	}
+}
+
+//----------------------------------------------------------------------
+static void count_degrees(const BucketGrid& grid,
+    const threshold_t& threshold, size_t* degrees,
+    unsigned int num_threads)
+{
+	/* Each node's degree is counted by the scan of its own
+	 * neighbourhood, so that the threads do not interfere: */
+	const size_t N = grid.size();
+	const size_t n_blocks = (N + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	parallel_for(n_blocks, num_threads, [&](size_t block){
+		const size_t end = std::min((block+1) * BLOCK_SIZE, N);
+		for (size_t p=block*BLOCK_SIZE; p<end; ++p){
+			size_t degree = 0;
+			grid.neighbours(threshold, p, [&](const node_t&){
+				++degree;
+			});
+			degrees[grid.node(p).id] = degree;
+		}
+	});
+}
+
+//----------------------------------------------------------------------
+template<typename index_t>
+static void geometric_graph_adjacency_csr(
+    const std::vector<Node>& coordinates,
+    std::vector<size_t>& offsets,
+    std::vector<index_t>& neighbours,
+    double sigma_0,
+    std::vector<float>* distances,
+    unsigned int num_threads)
+{
+	const size_t N = coordinates.size();
+	if (N > std::numeric_limits<index_t>::max()){
+		throw std::domain_error("ERROR : geometric_graph_adjacency() :\n"
+		                        + std::to_string(N) + " nodes cannot be "
+		                        "indexed by the requested index type.\n");
+	}
+
+	offsets.assign(N+1, 0);
+	neighbours.clear();
+	if (distances)
+		distances->clear();
+
+	/* No node pair is closer than a non-positive threshold: */
+	if (N == 0 || !(sigma_0 > 0.0))
+		return;
+
+	const threshold_t threshold(sigma_0);
+	const BucketGrid grid(coordinates, sigma_0);
+	const size_t n_blocks = (N + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	num_threads = std::min<size_t>(thread_count(num_threads), n_blocks);
+
+	/* Each node's row is written only by the scan of its own
+	 * neighbourhood, so that the threads do not interfere. This tests
+	 * each pair twice in each of the two passes, but the adjacency is
+	 * set up in its final memory without a list of links. */
+
+	/* First pass: Count the neighbours of each node: */
+	count_degrees(grid, threshold, offsets.data() + 1, num_threads);
+	for (size_t i=0; i<N; ++i){
+		offsets[i+1] += offsets[i];
+	}
+
+	/* Second pass: Fill in the neighbours of each node in ascending
+	 * order. The neighbours are found bucket by bucket, and within each
+	 * bucket in ascending order, so that they are sorted by merging
+	 * these runs: */
+	neighbours.resize(offsets[N]);
+	if (distances)
+		distances->resize(offsets[N]);
+	parallel_for(n_blocks, num_threads, [&](size_t block){
+		std::vector<std::pair<index_t,float>> row, buffer;
+		std::vector<size_t> runs;
+		const size_t end = std::min((block+1) * BLOCK_SIZE, N);
+		for (size_t p=block*BLOCK_SIZE; p<end; ++p){
+			const node_t& node = grid.node(p);
+			row.clear();
+			runs.assign(1, 0);
+			grid.neighbours(threshold, p, [&](const node_t& b){
+				if (!row.empty() && b.id < row.back().first)
+					runs.push_back(row.size());
+				row.emplace_back(b.id, distances
+				                       ? great_circle_distance(node, b)
+				                       : 0.0);
+			});
+			runs.push_back(row.size());
+			merge_runs(row, runs, buffer);
+
+			const size_t first = offsets[node.id];
+			for (size_t k=0; k<row.size(); ++k){
+				neighbours[first+k] = row[k].first;
+			}
+			if (distances){
+				for (size_t k=0; k<row.size(); ++k){
+					(*distances)[first+k] = row[k].second;
+				}
+			}
+		}
+	});
+}
+
+//----------------------------------------------------------------------
+void geometric_graph_adjacency(const std::vector<Node>& coordinates,
+    std::vector<size_t>& offsets, std::vector<size_t>& neighbours,
+    double sigma_0, std::vector<float>* distances,
+    unsigned int num_threads)
+{
+	geometric_graph_adjacency_csr(coordinates, offsets, neighbours,
+	                              sigma_0, distances, num_threads);
+}
+
+//----------------------------------------------------------------------
+void geometric_graph_adjacency(const std::vector<Node>& coordinates,
+    std::vector<size_t>& offsets, std::vector<uint32_t>& neighbours,
+    double sigma_0, std::vector<float>* distances,
+    unsigned int num_threads)
+{
+	geometric_graph_adjacency_csr(coordinates, offsets, neighbours,
+	                              sigma_0, distances, num_threads);
+}
+
+//----------------------------------------------------------------------
+void geometric_graph_adjacency(const std::vector<Node>& coordinates,
+    std::vector<size_t>& offsets, std::vector<uint16_t>& neighbours,
+    double sigma_0, std::vector<float>* distances,
+    unsigned int num_threads)
+{
+	geometric_graph_adjacency_csr(coordinates, offsets, neighbours,
+	                              sigma_0, distances, num_threads);
+}
+
+
+
+/* Number of links that a batch of geometric_graph_visit holds about: */
+constexpr size_t BATCH_SIZE = 1 << 16;
+
+//----------------------------------------------------------------------
+void geometric_graph_visit(const std::vector<Node>& coordinates,
+    double sigma_0, const geometric_graph_visitor_t& visit,
+    unsigned int num_threads)
+{
+	/* No node pair is closer than a non-positive threshold: */
+	const size_t N = coordinates.size();
+	if (N == 0 || !(sigma_0 > 0.0))
+		return;
+
+	const threshold_t threshold(sigma_0);
+	const BucketGrid grid(coordinates, sigma_0);
+
+	/* The size of the blocks of grid positions is chosen so that a
+	 * block yields about BATCH_SIZE links if the nodes are distributed
+	 * uniformly. Each node has about (N-1)*(1-cos(sigma_0))/2
+	 * neighbours, half of which follow it in the grid: */
+	const double links_per_node = 0.25 * (N - 1)
+	                              * (1.0 - std::cos(std::min(sigma_0, M_PI)));
+	const size_t block_size = std::max<size_t>(std::min<double>(
+	                     BATCH_SIZE / std::max(links_per_node, 1.0),
+	                     BLOCK_SIZE), 1);
+	const size_t n_blocks = (N + block_size - 1) / block_size;
+	num_threads = std::min<size_t>(thread_count(num_threads), n_blocks);
+
+	/* The blocks are processed in rounds of two blocks per thread.
+	 * After each round, the calling thread passes the blocks' links to
+	 * the visitor in order. This bounds the memory and makes the
+	 * batches independent of the number of threads: */
+	const size_t round = 2 * num_threads;
+	std::vector<std::vector<Link>> batches(round);
+	for (size_t first=0; first<n_blocks; first+=round){
+		const size_t count = std::min(round, n_blocks - first);
+		parallel_for(count, num_threads, [&](size_t k){
+			std::vector<Link>& batch = batches[k];
+			batch.clear();
+			const size_t block = first + k;
+			grid.connected_pairs(threshold, block * block_size,
+			    std::min((block+1) * block_size, N),
+			    [&](const node_t& a, const node_t& b){
+				batch.push_back({a.id, b.id});
+			});
+		});
+		for (size_t k=0; k<count; ++k){
+			if (!batches[k].empty())
+				visit(batches[k]);
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+void geometric_graph_degrees(const std::vector<Node>& coordinates,
+    std::vector<size_t>& degrees, double sigma_0,
+    unsigned int num_threads)
+{
+	degrees.assign(coordinates.size(), 0);
+
+	/* No node pair is closer than a non-positive threshold: */
+	if (coordinates.empty() || !(sigma_0 > 0.0))
+		return;
+
+	const threshold_t threshold(sigma_0);
+	const BucketGrid grid(coordinates, sigma_0);
+	num_threads = std::min<size_t>(thread_count(num_threads),
+	                     (grid.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	count_degrees(grid, threshold, degrees.data(), num_threads);
+}
+
+//----------------------------------------------------------------------
+static size_t find_root(std::vector<size_t>& parent, size_t i)
+{
+	/* Path halving: */
+	while (parent[i] != i){
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+//----------------------------------------------------------------------
+size_t geometric_graph_components(const std::vector<Node>& coordinates,
+    std::vector<size_t>& components, double sigma_0,
+    unsigned int num_threads)
+{
+	/* Union-find: Each node starts as its own component. The streamed
+	 * links join components by attaching the root with the larger
+	 * index to that with the smaller one: */
+	const size_t N = coordinates.size();
+	components.resize(N);
+	for (size_t i=0; i<N; ++i){
+		components[i] = i;
+	}
+	geometric_graph_visit(coordinates, sigma_0,
+	    [&](const std::vector<Link>& batch){
+		for (const Link& l : batch){
+			const size_t r0 = find_root(components, l.i);
+			const size_t r1 = find_root(components, l.j);
+			if (r0 < r1)
+				components[r1] = r0;
+			else if (r1 < r0)
+				components[r0] = r1;
+		}
+	}, num_threads);
+
+	/* Each node's parent precedes it, so that the components can be
+	 * numbered in order of their first node in a single pass, in which
+	 * the parent's label is known already: */
+	size_t n_components = 0;
+	for (size_t i=0; i<N; ++i){
+		if (components[i] == i)
+			components[i] = n_components++;
+		else
+			components[i] = components[components[i]];
+	}
+	return n_components;
+}
+
+
+//######################################################################
+
+/* Bits of each coordinate of a cube of the grid used to find duplicate
+ * nodes. The three coordinates are packed into the key of a cube: */
+static constexpr int CLONE_GRID_BITS = 21;
+
+//----------------------------------------------------------------------
+size_t CloneGrid::bytes() const
+{
+	return (x.capacity() + y.capacity() + z.capacity()) * sizeof(double)
+	    + (cells.capacity() + sort_buffer.capacity()) * sizeof(key_index_t)
+	    + representative.capacity() * sizeof(size_t);
+}
+
+//----------------------------------------------------------------------
+size_t find_cloned_nodes(const std::vector<Node>& nodes, double tolerance,
+    std::vector<size_t>& representative)
+{
+	CloneGrid grid;
+	return find_cloned_nodes(nodes, tolerance, representative, grid);
+}
+
+//----------------------------------------------------------------------
+size_t find_cloned_nodes(const std::vector<Node>& nodes, double tolerance,
+    std::vector<size_t>& representative, CloneGrid& grid)
+{
+	/* Two nodes are equal if the chord between their unit vectors is
+	 * not longer than that of the great circle distance 'tolerance'.
+	 * The grid's cubes are at least this long, so all nodes equal to
+	 * a node lie in the 27 cubes around its cube. The minimum cube
+	 * size keeps the shifted coordinates, which lie in [0,2], within
+	 * CLONE_GRID_BITS bits: */
+	const double chord = 2.0 * std::sin(0.5 * std::max(tolerance, 0.0));
+	const double chord2 = chord * chord;
+	const double inv_size
+	    = 1.0 / std::max(chord, std::ldexp(1.0, 2 - CLONE_GRID_BITS));
+
+	const size_t N = nodes.size();
+	std::vector<double>& x = grid.x;
+	std::vector<double>& y = grid.y;
+	std::vector<double>& z = grid.z;
+	x.resize(N);
+	y.resize(N);
+	z.resize(N);
+	for (size_t i=0; i<N; ++i){
+		const double clat = std::cos(nodes[i].lat);
+		x[i] = clat * std::cos(nodes[i].lon);
+		y[i] = clat * std::sin(nodes[i].lon);
+		z[i] = std::sin(nodes[i].lat);
+	}
+
+	/* Sort the nodes by their cubes. The sort is stable, so that the
+	 * nodes of each cube keep the order of their indices: */
+	auto cube = [inv_size](double c) -> uint64_t {
+		return (uint64_t)std::floor((c + 1.0) * inv_size);
+	};
+	std::vector<key_index_t>& cells = grid.cells;
+	cells.resize(N);
+	for (size_t i=0; i<N; ++i){
+		cells[i].key = (cube(x[i]) << (2*CLONE_GRID_BITS))
+		             | (cube(y[i]) << CLONE_GRID_BITS) | cube(z[i]);
+		cells[i].index = i;
+	}
+	radix_sort(cells, grid.sort_buffer, 1);
+	auto key_less = [](const key_index_t& cell, uint64_t key) -> bool {
+		return cell.key < key;
+	};
+
+	representative.resize(N);
+	size_t duplicates = 0;
+	for (size_t i=0; i<N; ++i){
+		const uint64_t ci = cube(x[i]), cj = cube(y[i]), ck = cube(z[i]);
+
+		/* Search the neighbouring cubes for the first equal
+		 * representative. For given first two coordinates, the three
+		 * cubes are adjacent in the sorted cells: */
+		size_t first = i;
+		for (uint64_t ni = (ci > 0) ? ci-1 : 0; ni <= ci+1; ++ni){
+			for (uint64_t nj = (cj > 0) ? cj-1 : 0; nj <= cj+1; ++nj){
+				const uint64_t row = (ni << (2*CLONE_GRID_BITS))
+				                   | (nj << CLONE_GRID_BITS);
+				auto it = std::lower_bound(cells.begin(), cells.end(),
+				                           row | ((ck > 0) ? ck-1 : 0),
+				                           key_less);
+				for (; it != cells.end() && it->key <= (row | (ck+1));
+				     ++it)
+				{
+					const size_t j = it->index;
+					if (j >= first || representative[j] != j)
+						continue;
+					const double dx = x[i] - x[j];
+					const double dy = y[i] - y[j];
+					const double dz = z[i] - z[j];
+					if (dx*dx + dy*dy + dz*dz <= chord2){
+						first = j;
+					}
+				}
+			}
+		}
+
+		representative[i] = first;
+		if (first != i){
+			++duplicates;
+		}
+	}
+
+	return duplicates;
+}
+
+
+//----------------------------------------------------------------------
+size_t merge_cloned_nodes(const std::vector<Node>& nodes, double tolerance,
+    std::vector<Node>& unique, std::vector<size_t>& merged)
+{
+	CloneGrid grid;
+	return merge_cloned_nodes(nodes, tolerance, unique, merged, grid);
+}
+
+//----------------------------------------------------------------------
+size_t merge_cloned_nodes(const std::vector<Node>& nodes, double tolerance,
+    std::vector<Node>& unique, std::vector<size_t>& merged,
+    CloneGrid& grid)
+{
+	size_t duplicates = find_cloned_nodes(nodes, tolerance, merged, grid);
+
+	/* Representatives precede the nodes they represent, so the
+	 * index map can be set up in one pass: */
+	unique.clear();
+	unique.reserve(nodes.size() - duplicates);
+	for (size_t i=0; i<nodes.size(); ++i){
+		if (merged[i] == i){
+			merged[i] = unique.size();
+			unique.push_back(nodes[i]);
+		} else {
+			merged[i] = merged[merged[i]];
+		}
+	}
+
+	return duplicates;
+}
+
+
+//----------------------------------------------------------------------
+void ensure_no_cloned_nodes(const std::vector<Node>& nodes,
+    double tolerance, const char* caller)
+{
+	CloneGrid grid;
+	ensure_no_cloned_nodes(nodes, tolerance, caller, grid);
+}
+
+//----------------------------------------------------------------------
+void ensure_no_cloned_nodes(const std::vector<Node>& nodes,
+    double tolerance, const char* caller, CloneGrid& grid)
+{
+	size_t duplicates = find_cloned_nodes(nodes, tolerance,
+	                                      grid.representative, grid);
+
+	if (duplicates > 0){
+		std::string message("ERROR : ");
+		message.append(caller).append(" :\nFound ")
+		       .append(std::to_string(duplicates))
+		       .append(" nodes that are equal within tolerance to "
+		               "another node.\n");
+		throw std::domain_error(message);
+	}
+}
+
 } // NAMESPACE ACOSA
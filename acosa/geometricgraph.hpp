@@ -23,32 +23,283 @@
  *     http://www.e-lc.org/docs/2011_12_05_14_35_11
  */
 
+#ifndef ACOSA_GEOMETRICGRAPH_HPP
+#define ACOSA_GEOMETRICGRAPH_HPP
+
 #include <basic_types.hpp>
+#include <radixsort.hpp>
 #include <vector>
+#include <cstdint>
+#include <functional>
 
 
 namespace ACOSA {
 
 
+/*!
+ * \brief Algorithms to calculate the links of a geometric graph.
+ */
+enum geometric_graph_algorithm_t {
+	/*! \brief A latitude belt of nodes, ordered by longitude in a
+	 *         search tree, is swept over the sphere, based off the
+	 *         spherically adapted Fortune's sweepline algorithm from
+	 *         [1]. It has a complexity of O(N*log(N) + N*M + M^2)
+	 *         and runs in a single thread.
+	 */
+	GEOMETRIC_GRAPH_SWEEP,
+	/*! \brief The nodes are sorted into contiguously stored buckets
+	 *         of roughly equal area in latitude bands of height
+	 *         sigma_0, and each node is compared to the nodes of the
+	 *         buckets that its sigma_0 circle overlaps. It has an
+	 *         expected complexity of O(N*M) for uniform node
+	 *         distributions.
+	 */
+	GEOMETRIC_GRAPH_BUCKETS
+};
+
+
 /*!
  * \brief Calculate the links of a geometric graph on a sphere.
  * \param coordinates Coordinates of the nodes of the graph.
- * \param links       Target vector for the links of the graph.
+ * \param links       Target vector to which the links of the graph
+ *                    are appended. Each link is contained twice, once
+ *                    in each direction.
  * \param sigma_0     The geometric graph's connection threshold.
  *                    All node pairs closer than sigma_0 will be
  *                    connected.
+ * \param algorithm   The algorithm to use. Both yield the same links
+ *                    in a different order.
+ * \param num_threads Number of threads used by the
+ *                    GEOMETRIC_GRAPH_BUCKETS algorithm. 0 selects the
+ *                    number of hardware threads. The links and their
+ *                    order do not depend on the number of threads.
  *
  * A geometric graph is a spatially embedded graph in which
  * nodes are connected pairwise iff they are distanced equal to
  * or less than a threshold distance (sigma_0).
  *
- * The algorithm used is based off the spherically adapted
- * Fortune's sweepline algorithm from [1]. It has a complexity
- * of O(N*log(N) + N*M + M^2) where N is the number of nodes and
- * M the mean degree of the geometric graph. For uniform spatial
- * node distributions, M~sigma_0^2.
+ * Here, N is the number of nodes and M the mean degree of the
+ * geometric graph. For uniform spatial node distributions,
+ * M~sigma_0^2.
+ *
+ * Node pairs are compared by the dot product of their unit vectors.
+ * The great circle distance is computed only for pairs whose distance
+ * is within rounding errors of sigma_0.
  */
 void geometric_graph_links(const std::vector<Node>& coordinates,
-    std::vector<Link>& links, double sigma_0);
+    std::vector<Link>& links, double sigma_0,
+    geometric_graph_algorithm_t algorithm = GEOMETRIC_GRAPH_BUCKETS,
+    unsigned int num_threads = 0);
+
+
+/*!
+ * \brief Calculate the adjacency of a geometric graph on a sphere in
+ *        compressed sparse row format.
+ * \param coordinates Coordinates of the nodes of the graph.
+ * \param offsets     Output vector of length N+1. The neighbours of
+ *                    node i are neighbours[offsets[i]] to
+ *                    neighbours[offsets[i+1]-1].
+ * \param neighbours  Output vector of the neighbours of all nodes,
+ *                    ascending for each node. Each link is contained
+ *                    twice, once for each of its nodes.
+ * \param sigma_0     The geometric graph's connection threshold (see
+ *                    geometric_graph_links).
+ * \param distances   If not null, output vector of the great circle
+ *                    distances corresponding to neighbours.
+ * \param num_threads Number of threads. 0 selects the number of
+ *                    hardware threads. The result does not depend on
+ *                    the number of threads.
+ *
+ * The adjacency is written to its final memory by two passes of the
+ * GEOMETRIC_GRAPH_BUCKETS algorithm, without an intermediate list of
+ * links. With 32-bit indices, it takes 8 bytes per link compared to
+ * the 32 bytes of geometric_graph_links, and with 16-bit indices for
+ * graphs of less than 65536 nodes 4 bytes. If the nodes cannot be
+ * indexed by the requested index type, an std::domain_error is
+ * thrown.
+ */
+void geometric_graph_adjacency(const std::vector<Node>& coordinates,
+    std::vector<size_t>& offsets, std::vector<size_t>& neighbours,
+    double sigma_0, std::vector<float>* distances = nullptr,
+    unsigned int num_threads = 0);
+
+void geometric_graph_adjacency(const std::vector<Node>& coordinates,
+    std::vector<size_t>& offsets, std::vector<uint32_t>& neighbours,
+    double sigma_0, std::vector<float>* distances = nullptr,
+    unsigned int num_threads = 0);
+
+void geometric_graph_adjacency(const std::vector<Node>& coordinates,
+    std::vector<size_t>& offsets, std::vector<uint16_t>& neighbours,
+    double sigma_0, std::vector<float>* distances = nullptr,
+    unsigned int num_threads = 0);
+
+
+/*!
+ * \brief Receives the links of a geometric graph batch by batch (see
+ *        geometric_graph_visit).
+ */
+typedef std::function<void(const std::vector<Link>&)>
+        geometric_graph_visitor_t;
+
+/*!
+ * \brief Stream the links of a geometric graph on a sphere.
+ * \param coordinates Coordinates of the nodes of the graph.
+ * \param sigma_0     The geometric graph's connection threshold (see
+ *                    geometric_graph_links).
+ * \param visit       Called with consecutive batches of the links. Each
+ *                    connected node pair is passed once, in one of its
+ *                    two directions.
+ * \param num_threads Number of threads. 0 selects the number of
+ *                    hardware threads.
+ *
+ * The links are found by the GEOMETRIC_GRAPH_BUCKETS algorithm in
+ * batches of about 65536 links for uniformly distributed nodes, and
+ * only a few batches per thread are held at a time. visit is called
+ * from the calling thread, and the batches do not depend on the
+ * number of threads. This allows to analyse graphs whose links do not
+ * fit into memory.
+ */
+void geometric_graph_visit(const std::vector<Node>& coordinates,
+    double sigma_0, const geometric_graph_visitor_t& visit,
+    unsigned int num_threads = 0);
+
+
+/*!
+ * \brief Calculate the degrees of the nodes of a geometric graph on a
+ *        sphere without storing its links.
+ * \param coordinates Coordinates of the nodes of the graph.
+ * \param degrees     Output vector of the number of neighbours of
+ *                    each node.
+ * \param sigma_0     The geometric graph's connection threshold (see
+ *                    geometric_graph_links).
+ * \param num_threads Number of threads. 0 selects the number of
+ *                    hardware threads.
+ */
+void geometric_graph_degrees(const std::vector<Node>& coordinates,
+    std::vector<size_t>& degrees, double sigma_0,
+    unsigned int num_threads = 0);
+
+
+/*!
+ * \brief Calculate the connected components of a geometric graph on a
+ *        sphere without storing its links.
+ * \param coordinates Coordinates of the nodes of the graph.
+ * \param components  Output vector of the component of each node. The
+ *                    components are numbered in order of their first
+ *                    node.
+ * \param sigma_0     The geometric graph's connection threshold (see
+ *                    geometric_graph_links).
+ * \param num_threads Number of threads used to find the links (see
+ *                    geometric_graph_visit).
+ * \return The number of components.
+ *
+ * The streamed links are joined by a union-find structure, so that the
+ * memory is O(N).
+ */
+size_t geometric_graph_components(const std::vector<Node>& coordinates,
+    std::vector<size_t>& components, double sigma_0,
+    unsigned int num_threads = 0);
+
+
+/*!
+ * \brief The buffers of the grid that is used to find duplicate nodes.
+ *
+ * The buffers may be kept between several calls of the functions
+ * below, so that they need not be allocated again.
+ */
+struct CloneGrid {
+	/* Unit vectors of the nodes: */
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> z;
+
+	/* The nodes sorted by the key of their cube, and the buffer of the
+	 * sort: */
+	std::vector<key_index_t> cells;
+	std::vector<key_index_t> sort_buffer;
+
+	/* Representatives of ensure_no_cloned_nodes: */
+	std::vector<size_t> representative;
+
+	/* Memory held by the buffers: */
+	size_t bytes() const;
+};
+
+
+/*!
+ * \brief Find nodes that are equal within tolerance to another node.
+ * \param nodes          The nodes to check.
+ * \param tolerance      The distance below which two nodes count as
+ *                       equal.
+ * \param representative Output vector of length nodes.size(). For each
+ *                       node, the index of the first node that is
+ *                       equal to it (itself if none of the nodes before
+ *                       it is).
+ * \return The number of duplicate nodes, i.e. of nodes that are not
+ *         their own representative.
+ *
+ * The unit vectors of the nodes are quantized to a grid of cubes whose
+ * edge length is the chord length of tolerance, but at least 2^-19,
+ * and only nodes in neighbouring cubes are compared. The nodes are
+ * sorted by their cubes, which are then found by binary search. The
+ * complexity is O(N*log(N)) unless many nodes crowd a single cube.
+ *
+ * Nodes are only compared to representatives, so each node is within
+ * tolerance of its representative.
+ */
+size_t find_cloned_nodes(const std::vector<Node>& nodes, double tolerance,
+    std::vector<size_t>& representative);
+
+
+/*!
+ * \brief Same as above, but uses the buffers of the given grid.
+ */
+size_t find_cloned_nodes(const std::vector<Node>& nodes, double tolerance,
+    std::vector<size_t>& representative, CloneGrid& grid);
+
+
+/*!
+ * \brief Merge nodes that are equal within tolerance.
+ * \param nodes     The nodes to merge.
+ * \param tolerance The distance below which two nodes count as equal.
+ * \param unique    Output vector of the representatives of the nodes
+ *                  (see find_cloned_nodes), in order of their indices.
+ * \param merged    Output vector of length nodes.size() that maps each
+ *                  node to the index of its representative in unique.
+ * \return The number of duplicate nodes that have been merged.
+ */
+size_t merge_cloned_nodes(const std::vector<Node>& nodes, double tolerance,
+    std::vector<Node>& unique, std::vector<size_t>& merged);
+
+
+/*!
+ * \brief Same as above, but uses the buffers of the given grid.
+ */
+size_t merge_cloned_nodes(const std::vector<Node>& nodes, double tolerance,
+    std::vector<Node>& unique, std::vector<size_t>& merged,
+    CloneGrid& grid);
+
+
+/*!
+ * \brief Make sure that no two nodes are within tolerance of each other.
+ * \param nodes     The nodes to check.
+ * \param tolerance The distance below which two nodes count as equal.
+ * \param caller    Name of the calling function, used in the error
+ *                  message.
+ *
+ * Throws an std::domain_error if duplicate nodes are found. The check
+ * uses find_cloned_nodes.
+ */
+void ensure_no_cloned_nodes(const std::vector<Node>& nodes,
+    double tolerance, const char* caller);
+
+
+/*!
+ * \brief Same as above, but uses the buffers of the given grid.
+ */
+void ensure_no_cloned_nodes(const std::vector<Node>& nodes,
+    double tolerance, const char* caller, CloneGrid& grid);
 
 }
+
+#endif // ACOSA_GEOMETRICGRAPH_HPP
@@ -0,0 +1,184 @@
+/* Half-edge representation of a triangulation of the sphere. Part of
+ * ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <halfedge.hpp>
+
+#include <stdexcept>
+#include <string>
+
+namespace ACOSA {
+
+constexpr size_t HalfEdgeMesh::NO_EDGE;
+
+//----------------------------------------------------------------------
+HalfEdgeMesh::HalfEdgeMesh() : triangles(nullptr)
+{
+}
+
+//----------------------------------------------------------------------
+HalfEdgeMesh::HalfEdgeMesh(const std::vector<Triangle>& triangles,
+    const CSRIncidence& node_triangles)
+    : triangles(nullptr)
+{
+	assign(triangles, node_triangles);
+}
+
+//----------------------------------------------------------------------
+void HalfEdgeMesh::assign(const std::vector<Triangle>& triangles,
+    const CSRIncidence& node_triangles)
+{
+	this->triangles = triangles.data();
+	twins.assign(3*triangles.size(), NO_EDGE);
+	outgoing_.assign(node_triangles.size(), NO_EDGE);
+	const size_t H = twins.size();
+
+	/* The twin of a half-edge (i,j) is the half-edge (j,i), which is
+	 * found among the few triangles of j: */
+	for (size_t e=0; e<H; ++e){
+		if (twins[e] != NO_EDGE)
+			continue;
+		const size_t i = origin(e);
+		const size_t j = target(e);
+		for (size_t m : node_triangles[j]){
+			const size_t f = outgoing_edge(m, j);
+			if (twins[f] == NO_EDGE && target(f) == i){
+				twins[e] = f;
+				twins[f] = e;
+				break;
+			}
+		}
+		if (twins[e] == NO_EDGE){
+			throw std::runtime_error("ERROR : HalfEdgeMesh() :\nHalf-edge ("
+			                         + std::to_string(i) + ","
+			                         + std::to_string(j) + ") has no "
+			                         "twin.\n");
+		}
+	}
+
+	for (size_t i=0; i<outgoing_.size(); ++i){
+		if (node_triangles[i].size() > 0){
+			outgoing_[i] = outgoing_edge(*node_triangles[i].begin(), i);
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::size() const
+{
+	return twins.size();
+}
+
+//----------------------------------------------------------------------
+bool HalfEdgeMesh::empty() const
+{
+	return twins.empty();
+}
+
+//----------------------------------------------------------------------
+void HalfEdgeMesh::clear()
+{
+	std::vector<size_t>().swap(twins);
+	std::vector<size_t>().swap(outgoing_);
+	triangles = nullptr;
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::vertex(const Triangle& t, size_t k)
+{
+	return (k == 0) ? t.i : ((k == 1) ? t.j : t.k);
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::outgoing_edge(size_t m, size_t node) const
+{
+	const Triangle& t = triangles[m];
+	return 3*m + ((t.i == node) ? 0 : ((t.j == node) ? 1 : 2));
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::origin(size_t e) const
+{
+	return vertex(triangles[e / 3], e % 3);
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::target(size_t e) const
+{
+	return vertex(triangles[e / 3], (e + 1) % 3);
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::twin(size_t e) const
+{
+	return twins[e];
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::triangle(size_t e)
+{
+	return e / 3;
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::next(size_t e)
+{
+	return (e % 3 == 2) ? e - 2 : e + 1;
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::prev(size_t e)
+{
+	return (e % 3 == 0) ? e + 2 : e - 1;
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::outgoing(size_t node) const
+{
+	return outgoing_[node];
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::rotate(size_t e) const
+{
+	/* prev(e) leads to the origin of e, so its twin leads away from
+	 * it: */
+	return twins[prev(e)];
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::find(size_t i, size_t j) const
+{
+	const size_t first = outgoing_[i];
+	if (first == NO_EDGE)
+		return NO_EDGE;
+	size_t e = first;
+	do {
+		if (target(e) == j)
+			return e;
+		e = rotate(e);
+	} while (e != first);
+	return NO_EDGE;
+}
+
+//----------------------------------------------------------------------
+size_t HalfEdgeMesh::bytes() const
+{
+	return (twins.capacity() + outgoing_.capacity()) * sizeof(size_t);
+}
+
+} // NAMESPACE ACOSA
@@ -0,0 +1,121 @@
+/* Half-edge representation of a triangulation of the sphere. Part of
+ * ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACOSA_HALFEDGE_HPP
+#define ACOSA_HALFEDGE_HPP
+
+#include <basic_types.hpp>
+#include <incidence.hpp>
+#include <vector>
+#include <limits>
+
+namespace ACOSA {
+
+/*!
+ * \brief The half-edges of a closed triangulation of the sphere.
+ *
+ * The half-edges are implicitly given by the triangles: Half-edge
+ * 3*t+k of triangle t leads from its k-th to its (k+1)-th vertex, so
+ * that the next and previous half-edges of a triangle are computed.
+ * Only the twins, i.e. the half-edges of the adjacent triangles in
+ * opposite direction, and one outgoing half-edge per node are stored.
+ *
+ * This requires all triangles to be oriented alike, as those of all
+ * Delaunay triangulation algorithms of ACOSA are (counterclockwise
+ * when seen from outside the sphere).
+ *
+ * The mesh refers to the triangles' storage, which hence must neither
+ * be modified nor reallocated while the mesh is used.
+ */
+class HalfEdgeMesh {
+	public:
+		constexpr static size_t NO_EDGE = std::numeric_limits<size_t>::max();
+
+		HalfEdgeMesh();
+
+		/*!
+		 * \brief Set up the half-edges of a triangulation.
+		 * \param triangles The triangles.
+		 * \param node_triangles The incidence of the nodes and the
+		 *                       triangles (see
+		 *                       CSRIncidence::node_triangles).
+		 *
+		 * The twin of a half-edge is found among the triangles of its
+		 * target, so the complexity is O(N).
+		 * Throws an std::runtime_error if a half-edge has no twin,
+		 * i.e. if the triangles do not form a closed, consistently
+		 * oriented triangulation.
+		 */
+		HalfEdgeMesh(const std::vector<Triangle>& triangles,
+		             const CSRIncidence& node_triangles);
+
+		/* Set up the half-edges of another triangulation, reusing the
+		 * capacity of the mesh: */
+		void assign(const std::vector<Triangle>& triangles,
+		            const CSRIncidence& node_triangles);
+
+		/* Number of half-edges: */
+		size_t size() const;
+
+		bool empty() const;
+
+		/* Release the memory: */
+		void clear();
+
+		size_t origin(size_t e) const;
+
+		size_t target(size_t e) const;
+
+		size_t twin(size_t e) const;
+
+		static size_t triangle(size_t e);
+
+		static size_t next(size_t e);
+
+		static size_t prev(size_t e);
+
+		/* One of the half-edges leading away from a node, or NO_EDGE
+		 * if the node is not part of any triangle: */
+		size_t outgoing(size_t node) const;
+
+		/* The next half-edge leading away from the origin of e, in
+		 * counterclockwise direction when seen from outside.
+		 * Successive half-edges belong to adjacent triangles: */
+		size_t rotate(size_t e) const;
+
+		/* The half-edge from node i to node j, or NO_EDGE if they are
+		 * not connected. Complexity O(degree of i). */
+		size_t find(size_t i, size_t j) const;
+
+		/* Memory held by the mesh: */
+		size_t bytes() const;
+
+	private:
+		const Triangle* triangles;
+		std::vector<size_t> twins;
+		std::vector<size_t> outgoing_;
+
+		static size_t vertex(const Triangle& t, size_t k);
+
+		/* The half-edge of triangle m leading away from node: */
+		size_t outgoing_edge(size_t m, size_t node) const;
+};
+
+} // NAMESPACE ACOSA
+
+#endif // ACOSA_HALFEDGE_HPP
@@ -0,0 +1,172 @@
+/* Compressed sparse row incidence used in ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <incidence.hpp>
+
+namespace ACOSA {
+
+//----------------------------------------------------------------------
+CSRIncidence::row_t::row_t(const size_t* first, const size_t* last)
+    : first(first), last(last)
+{
+}
+
+//----------------------------------------------------------------------
+const size_t* CSRIncidence::row_t::begin() const
+{
+	return first;
+}
+
+//----------------------------------------------------------------------
+const size_t* CSRIncidence::row_t::end() const
+{
+	return last;
+}
+
+//----------------------------------------------------------------------
+size_t CSRIncidence::row_t::size() const
+{
+	return last - first;
+}
+
+
+//######################################################################
+
+//----------------------------------------------------------------------
+CSRIncidence::CSRIncidence()
+{
+}
+
+//----------------------------------------------------------------------
+CSRIncidence
+CSRIncidence::node_triangles(const std::vector<Triangle>& triangles,
+                             size_t N)
+{
+	CSRIncidence incidence;
+	incidence.assign_node_triangles(triangles, N);
+	return incidence;
+}
+
+//----------------------------------------------------------------------
+CSRIncidence CSRIncidence::inverse(const std::vector<size_t>& map,
+                                   size_t rows)
+{
+	CSRIncidence incidence;
+	incidence.assign_inverse(map, rows);
+	return incidence;
+}
+
+//----------------------------------------------------------------------
+void CSRIncidence::assign_node_triangles(
+    const std::vector<Triangle>& triangles, size_t N)
+{
+	/* First pass: Count the triangles of each node: */
+	offsets.assign(N+1, 0);
+	for (const Triangle& t : triangles){
+		++offsets[t.i];
+		++offsets[t.j];
+		++offsets[t.k];
+	}
+	count_to_offsets(N);
+
+	/* Second pass: Fill in the triangles in ascending order: */
+	columns.resize(3*triangles.size());
+	for (size_t m=0; m<triangles.size(); ++m){
+		const Triangle& t = triangles[m];
+		columns[offsets[t.i]++] = m;
+		columns[offsets[t.j]++] = m;
+		columns[offsets[t.k]++] = m;
+	}
+	restore_offsets(N);
+}
+
+//----------------------------------------------------------------------
+void CSRIncidence::assign_inverse(const std::vector<size_t>& map,
+                                  size_t rows)
+{
+	/* First pass: Count the columns of each row: */
+	offsets.assign(rows+1, 0);
+	for (size_t row : map){
+		++offsets[row];
+	}
+	count_to_offsets(rows);
+
+	/* Second pass: Fill in the columns in ascending order: */
+	columns.resize(map.size());
+	for (size_t m=0; m<map.size(); ++m){
+		columns[offsets[map[m]]++] = m;
+	}
+	restore_offsets(rows);
+}
+
+//----------------------------------------------------------------------
+void CSRIncidence::count_to_offsets(size_t rows)
+{
+	/* Exclusive prefix sum, so that offsets[i] is the start of row i: */
+	size_t sum = 0;
+	for (size_t i=0; i<rows; ++i){
+		const size_t count = offsets[i];
+		offsets[i] = sum;
+		sum += count;
+	}
+	offsets[rows] = sum;
+}
+
+//----------------------------------------------------------------------
+void CSRIncidence::restore_offsets(size_t rows)
+{
+	/* Filling the rows has advanced each start to the end of its row,
+	 * which is the start of the next row: */
+	for (size_t i=rows; i>0; --i){
+		offsets[i] = offsets[i-1];
+	}
+	offsets[0] = 0;
+}
+
+//----------------------------------------------------------------------
+CSRIncidence::row_t CSRIncidence::operator[](size_t row) const
+{
+	const size_t* data = columns.data();
+	return row_t(data + offsets[row], data + offsets[row+1]);
+}
+
+//----------------------------------------------------------------------
+size_t CSRIncidence::size() const
+{
+	return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+//----------------------------------------------------------------------
+bool CSRIncidence::empty() const
+{
+	return offsets.empty();
+}
+
+//----------------------------------------------------------------------
+void CSRIncidence::clear()
+{
+	std::vector<size_t>().swap(offsets);
+	std::vector<size_t>().swap(columns);
+}
+
+//----------------------------------------------------------------------
+size_t CSRIncidence::bytes() const
+{
+	return (offsets.capacity() + columns.capacity()) * sizeof(size_t);
+}
+
+} // NAMESPACE ACOSA
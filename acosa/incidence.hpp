@@ -0,0 +1,102 @@
+/* Compressed sparse row incidence used in ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACOSA_INCIDENCE_HPP
+#define ACOSA_INCIDENCE_HPP
+
+#include <basic_types.hpp>
+#include <vector>
+
+namespace ACOSA {
+
+/*!
+ * \brief An incidence relation in compressed sparse row format.
+ *
+ * Each row (e.g. a node) is incident to a set of columns (e.g.
+ * triangles). The columns of all rows are stored in one array, ordered
+ * by row and, within each row, ascending, so that the columns of row i
+ * are found between offsets[i] and offsets[i+1].
+ * The incidence is built in two counting passes. The assign methods
+ * rebuild an incidence in the capacity it already holds.
+ */
+class CSRIncidence {
+	public:
+		/*!
+		 * \brief The columns of one row.
+		 */
+		class row_t {
+			public:
+				const size_t* begin() const;
+				const size_t* end() const;
+				size_t size() const;
+
+			private:
+				friend class CSRIncidence;
+				row_t(const size_t* first, const size_t* last);
+
+				const size_t* first;
+				const size_t* last;
+		};
+
+		CSRIncidence();
+
+		/*!
+		 * \brief Incidence of N nodes and the triangles that contain
+		 *        them.
+		 */
+		static CSRIncidence
+		node_triangles(const std::vector<Triangle>& triangles, size_t N);
+
+		/*!
+		 * \brief Inverse of a map from columns to rows.
+		 * \param map For each column, the row it belongs to.
+		 * \param rows Number of rows.
+		 */
+		static CSRIncidence inverse(const std::vector<size_t>& map,
+		                            size_t rows);
+
+		void assign_node_triangles(const std::vector<Triangle>& triangles,
+		                           size_t N);
+
+		void assign_inverse(const std::vector<size_t>& map, size_t rows);
+
+		row_t operator[](size_t row) const;
+
+		/* Number of rows: */
+		size_t size() const;
+
+		bool empty() const;
+
+		/* Release the memory: */
+		void clear();
+
+		/* Memory held by the incidence: */
+		size_t bytes() const;
+
+	private:
+		std::vector<size_t> offsets;
+		std::vector<size_t> columns;
+
+		/* Turns counts into row starts and back: */
+		void count_to_offsets(size_t rows);
+
+		void restore_offsets(size_t rows);
+};
+
+} // NAMESPACE ACOSA
+
+#endif // ACOSA_INCIDENCE_HPP
@@ -0,0 +1,515 @@
+/* Randomized incremental convex hull algorithm for the Delaunay
+ * triangulation on a sphere. Part of ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Bibliography:
+ * [1] Nina Amenta, Dominique Attali, Olivier Devillers: Complexity of
+ *     Delaunay triangulation for points on lower-dimensional polyhedra,
+ *     in: Proceedings of the 18th ACM-SIAM Symposium on Discrete
+ *     Algorithms (2007), pp. 1106-1113
+ *     (biased randomized insertion order, BRIO)
+ * [2] Olivier Devillers, Sylvain Pion, Monique Teillaud: Walking in a
+ *     triangulation, in: International Journal of Foundations of
+ *     Computer Science 13 (2002), pp. 181-199
+ */
+
+#include <incrementalhull.hpp>
+#include <spherics.hpp>
+#include <radixsort.hpp>
+#include <predicates.hpp>
+#include <geometricgraph.hpp>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <limits>
+#include <algorithm>
+
+namespace ACOSA {
+
+static constexpr size_t NO_FACE = std::numeric_limits<size_t>::max();
+
+//######################################################################
+
+struct hull_point_t {
+	double x;
+	double y;
+	double z;
+};
+
+
+/* A face of the hull. Its vertices are ordered counterclockwise when
+ * seen from outside. nb[k] is the face across the edge (v[k], v[k+1]).
+ */
+struct hull_face_t {
+	size_t v[3];
+	size_t nb[3];
+	size_t visit;
+};
+
+
+//----------------------------------------------------------------------
+static double orient(const hull_point_t& a, const hull_point_t& b,
+                     const hull_point_t& c, const hull_point_t& d)
+{
+	/* Positive if d lies on the side of the plane through a, b, and c
+	 * into which (b-a) x (c-a) points. The sign is exact: */
+	const double pa[3] = {a.x, a.y, a.z};
+	const double pb[3] = {b.x, b.y, b.z};
+	const double pc[3] = {c.x, c.y, c.z};
+	const double pd[3] = {d.x, d.y, d.z};
+	return -orient3d(pa, pb, pc, pd);
+}
+
+
+//----------------------------------------------------------------------
+static uint64_t morton_split(uint64_t v)
+{
+	/* Spread the lower 21 bits of v to every third bit: */
+	v &= 0x1FFFFF;
+	v = (v | (v << 32)) & 0x1F00000000FFFFull;
+	v = (v | (v << 16)) & 0x1F0000FF0000FFull;
+	v = (v | (v << 8))  & 0x100F00F00F00F00Full;
+	v = (v | (v << 4))  & 0x10C30C30C30C30C3ull;
+	v = (v | (v << 2))  & 0x1249249249249249ull;
+	return v;
+}
+
+//----------------------------------------------------------------------
+static uint64_t morton_key(const hull_point_t& p)
+{
+	/* Map [-1,1] to 21 bit integers and interleave: */
+	const double scale = 0.5 * ((1 << 21) - 1);
+	uint64_t x = static_cast<uint64_t>((p.x + 1.0) * scale);
+	uint64_t y = static_cast<uint64_t>((p.y + 1.0) * scale);
+	uint64_t z = static_cast<uint64_t>((p.z + 1.0) * scale);
+	return morton_split(x) | (morton_split(y) << 1)
+	       | (morton_split(z) << 2);
+}
+
+
+//----------------------------------------------------------------------
+static void insertion_order(const std::vector<hull_point_t>& points,
+                            std::vector<size_t>& order,
+                            unsigned int num_threads)
+{
+	/* Biased randomized insertion order [1]: Each node is assigned to
+	 * the last round with probability 1/2, to the round before with
+	 * probability 1/4, and so on. Within the rounds, the nodes are
+	 * sorted along a Morton curve so that consecutive nodes are close
+	 * to each other. A fixed seed keeps the result reproducible. */
+	const size_t N = points.size();
+	unsigned int rounds = 0;
+	while ((size_t(1) << rounds) < N){
+		++rounds;
+	}
+
+	std::vector<key_index_t> keys(N);
+	for (size_t i=0; i<N; ++i){
+		keys[i].key = morton_key(points[i]);
+		keys[i].index = i;
+	}
+	radix_sort(keys, num_threads);
+
+	std::mt19937_64 generator(N);
+	for (key_index_t& k : keys){
+		uint64_t r = generator() | (uint64_t(1) << rounds);
+		unsigned int round = 0;
+		while (!(r & 1)){
+			r >>= 1;
+			++round;
+		}
+		k.key = rounds - round;
+	}
+	radix_sort(keys, num_threads);
+
+	order.resize(N);
+	for (size_t i=0; i<N; ++i){
+		order[i] = keys[i].index;
+	}
+}
+
+
+
+//######################################################################
+
+class IncrementalHull {
+	public:
+		/* Creates the tetrahedron of four nodes that are not on a common
+		 * circle: */
+		IncrementalHull(const std::vector<hull_point_t>& points, size_t a,
+		                size_t b, size_t c, size_t d);
+
+		void insert(size_t p);
+
+		/* Appends the faces, translating the vertices by ids: */
+		void triangles(const std::vector<size_t>& ids,
+		               std::vector<Triangle>& triangles) const;
+
+	private:
+		const std::vector<hull_point_t>& points;
+
+		/* A point inside the hull. */
+		hull_point_t center;
+
+		std::vector<hull_face_t> faces;
+		std::vector<size_t> free_faces;
+
+		/* The last created face, where the walk starts: */
+		size_t last;
+
+		/* Marks for the search of visible faces: */
+		size_t stamp = 0;
+		std::vector<size_t> vertex_stamp;
+		std::vector<size_t> vertex_face;
+		std::vector<size_t> region;
+
+		struct horizon_t {
+			size_t u;
+			size_t v;
+			size_t outside;
+		};
+		std::vector<horizon_t> horizon;
+
+		/* State of the walk's random number generator: */
+		uint64_t random = 0x9E3779B97F4A7C15ull;
+
+		size_t new_face(size_t a, size_t b, size_t c);
+
+		void link(size_t f, size_t g);
+
+		double visibility(size_t f, const hull_point_t& p) const;
+
+		size_t locate(const hull_point_t& p);
+};
+
+
+//----------------------------------------------------------------------
+IncrementalHull::IncrementalHull(const std::vector<hull_point_t>& points,
+    size_t a, size_t b, size_t c, size_t d)
+    : points(points), vertex_stamp(points.size(), 0),
+      vertex_face(points.size(), NO_FACE)
+{
+	/* Make sure that (a,b,c) is counterclockwise seen from outside, i.e.
+	 * that d is below: */
+	if (orient(points[a], points[b], points[c], points[d]) > 0.0){
+		std::swap(b, c);
+	}
+
+	const hull_point_t& pa = points[a];
+	const hull_point_t& pb = points[b];
+	const hull_point_t& pc = points[c];
+	const hull_point_t& pd = points[d];
+	center.x = 0.25 * (pa.x + pb.x + pc.x + pd.x);
+	center.y = 0.25 * (pa.y + pb.y + pc.y + pd.y);
+	center.z = 0.25 * (pa.z + pb.z + pc.z + pd.z);
+
+	/* The four faces. All are counterclockwise seen from outside: */
+	size_t f[4] = {new_face(a, b, c), new_face(a, d, b), new_face(b, d, c),
+	               new_face(c, d, a)};
+	for (int i=0; i<4; ++i){
+		for (int j=i+1; j<4; ++j){
+			link(f[i], f[j]);
+		}
+	}
+	last = f[0];
+}
+
+//----------------------------------------------------------------------
+size_t IncrementalHull::new_face(size_t a, size_t b, size_t c)
+{
+	size_t f;
+	if (free_faces.empty()){
+		f = faces.size();
+		faces.emplace_back();
+	} else {
+		f = free_faces.back();
+		free_faces.pop_back();
+	}
+	hull_face_t& F = faces[f];
+	F.v[0] = a;
+	F.v[1] = b;
+	F.v[2] = c;
+	F.nb[0] = F.nb[1] = F.nb[2] = NO_FACE;
+	F.visit = 0;
+	return f;
+}
+
+//----------------------------------------------------------------------
+void IncrementalHull::link(size_t f, size_t g)
+{
+	/* Connects two faces of the initial tetrahedron if they share an
+	 * edge: */
+	hull_face_t& F = faces[f];
+	hull_face_t& G = faces[g];
+	for (int k=0; k<3; ++k){
+		for (int l=0; l<3; ++l){
+			if (F.v[k] == G.v[(l+1)%3] && F.v[(k+1)%3] == G.v[l]){
+				F.nb[k] = g;
+				G.nb[l] = f;
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+double IncrementalHull::visibility(size_t f, const hull_point_t& p) const
+{
+	const hull_face_t& F = faces[f];
+	return orient(points[F.v[0]], points[F.v[1]], points[F.v[2]], p);
+}
+
+//----------------------------------------------------------------------
+size_t IncrementalHull::locate(const hull_point_t& p)
+{
+	/* Walk [2] towards the face through which the ray from the center to
+	 * p leaves the hull. That face is visible from p. The walk crosses
+	 * an edge whose plane with the center separates the face from p.
+	 * The order in which the edges are tested is randomized so that the
+	 * walk cannot cycle. */
+	size_t f = last;
+	bool found = false;
+	for (size_t step=0; step<faces.size(); ++step){
+		const hull_face_t& F = faces[f];
+		random ^= random << 13;
+		random ^= random >> 7;
+		random ^= random << 17;
+		int k0 = random % 3;
+		bool moved = false;
+		for (int j=0; j<3; ++j){
+			int k = (k0 + j) % 3;
+			if (orient(center, points[F.v[k]], points[F.v[(k+1)%3]], p)
+			    < 0.0)
+			{
+				f = F.nb[k];
+				moved = true;
+				break;
+			}
+		}
+		if (!moved){
+			found = true;
+			break;
+		}
+	}
+
+	/* Due to rounding, the face might not be visible if p is close to
+	 * its circumcircle. Try its neighbours: */
+	if (found && visibility(f, p) <= 0.0){
+		found = false;
+		for (int k=0; k<3; ++k){
+			if (visibility(faces[f].nb[k], p) > 0.0){
+				f = faces[f].nb[k];
+				found = true;
+				break;
+			}
+		}
+	}
+
+	/* If the walk failed, fall back to testing all faces: */
+	if (!found){
+		double best = 0.0;
+		for (size_t g=0; g<faces.size(); ++g){
+			if (faces[g].v[0] == NO_FACE){
+				continue;
+			}
+			double vis = visibility(g, p);
+			if (vis > best){
+				best = vis;
+				f = g;
+				found = true;
+			}
+		}
+		if (!found){
+			throw std::runtime_error("ERROR : delaunay_triangulation_hull() :"
+			                         "\nNo hull face is visible from a "
+			                         "node.\n");
+		}
+	}
+	return f;
+}
+
+//----------------------------------------------------------------------
+void IncrementalHull::insert(size_t id)
+{
+	const hull_point_t& p = points[id];
+
+	/* 1) Find a face visible from p: */
+	size_t f0 = locate(p);
+
+	/* 2) Collect the visible region by a breadth first search. A face
+	 *    is added only if it shares exactly one edge with the region and
+	 *    its third vertex is not yet part of the region. This keeps the
+	 *    region a disk whose vertices all stay on the hull, even if
+	 *    rounding errors make the visibility tests inconsistent. For
+	 *    nodes on a sphere, the exact visible region always has this
+	 *    property. */
+	const size_t in_region = 2*(++stamp);
+	const size_t rejected = in_region + 1;
+	region.clear();
+	region.push_back(f0);
+	faces[f0].visit = in_region;
+	for (int k=0; k<3; ++k){
+		vertex_stamp[faces[f0].v[k]] = stamp;
+	}
+	for (size_t r=0; r<region.size(); ++r){
+		for (int k=0; k<3; ++k){
+			size_t g = faces[region[r]].nb[k];
+			hull_face_t& G = faces[g];
+			if (G.visit == in_region || G.visit == rejected){
+				continue;
+			}
+			int shared = 0;
+			size_t opposite = NO_FACE;
+			for (int l=0; l<3; ++l){
+				if (faces[G.nb[l]].visit == in_region){
+					++shared;
+					opposite = G.v[(l+2)%3];
+				}
+			}
+			if (shared == 1 && vertex_stamp[opposite] != stamp
+			    && visibility(g, p) > 0.0)
+			{
+				G.visit = in_region;
+				vertex_stamp[opposite] = stamp;
+				region.push_back(g);
+			} else {
+				G.visit = rejected;
+			}
+		}
+	}
+
+	/* 3) Collect the horizon, i.e. the region's border edges, and
+	 *    remove the region: */
+	horizon.clear();
+	for (size_t r : region){
+		hull_face_t& R = faces[r];
+		for (int k=0; k<3; ++k){
+			if (faces[R.nb[k]].visit != in_region){
+				horizon.push_back({R.v[k], R.v[(k+1)%3], R.nb[k]});
+			}
+		}
+		R.v[0] = NO_FACE;
+		free_faces.push_back(r);
+	}
+
+	/* 4) Connect the horizon to p: */
+	for (const horizon_t& h : horizon){
+		size_t n = new_face(h.u, h.v, id);
+		hull_face_t& O = faces[h.outside];
+		for (int l=0; l<3; ++l){
+			if (O.v[l] == h.v && O.v[(l+1)%3] == h.u){
+				O.nb[l] = n;
+				break;
+			}
+		}
+		faces[n].nb[0] = h.outside;
+		vertex_face[h.u] = n;
+		last = n;
+	}
+	for (const horizon_t& h : horizon){
+		size_t n = vertex_face[h.u];
+		size_t m = vertex_face[h.v];
+		faces[n].nb[1] = m;
+		faces[m].nb[2] = n;
+	}
+}
+
+//----------------------------------------------------------------------
+void IncrementalHull::triangles(const std::vector<size_t>& ids,
+    std::vector<Triangle>& triangles) const
+{
+	triangles.reserve(triangles.size() + faces.size()
+	                  - free_faces.size());
+	for (const hull_face_t& F : faces){
+		if (F.v[0] != NO_FACE){
+			triangles.emplace_back(ids[F.v[0]], ids[F.v[1]], ids[F.v[2]]);
+		}
+	}
+}
+
+
+
+//######################################################################
+
+void convex_hull_triangles(const EuclidTable& nodes,
+    const std::vector<size_t>& ids, std::vector<Triangle>& triangles,
+    unsigned int num_threads)
+{
+	const size_t N = ids.size();
+	if (N < 4){
+		throw std::runtime_error("ERROR : convex_hull_triangles() :\n"
+		                         "Need at least four nodes.\n");
+	}
+
+	/* 1) Unit vectors and insertion order: */
+	std::vector<hull_point_t> points(N);
+	for (size_t i=0; i<N; ++i){
+		points[i] = {nodes.x[ids[i]], nodes.y[ids[i]], nodes.z[ids[i]]};
+	}
+	std::vector<size_t> order;
+	insertion_order(points, order, num_threads);
+
+	/* 2) Initial tetrahedron. Three distinct nodes on a sphere are never
+	 *    collinear, so we need only search the fourth node that is not
+	 *    on the circle through the first three: */
+	size_t n3 = 3;
+	while (n3 < N && orient(points[order[0]], points[order[1]],
+	                        points[order[2]], points[order[n3]]) == 0.0)
+	{
+		++n3;
+	}
+	if (n3 == N){
+		throw std::runtime_error("ERROR : convex_hull_triangles() :\n"
+		                         "All nodes lie on a common circle.\n");
+	}
+	IncrementalHull hull(points, order[0], order[1], order[2], order[n3]);
+
+	/* 3) Insert the remaining nodes: */
+	for (size_t i=3; i<N; ++i){
+		if (i != n3){
+			hull.insert(order[i]);
+		}
+	}
+
+	/* 4) The faces are the Delaunay triangles: */
+	hull.triangles(ids, triangles);
+}
+
+
+//----------------------------------------------------------------------
+void delaunay_triangulation_hull(const std::vector<Node>& nodes,
+    std::vector<Triangle>& delaunay_triangles, double tolerance,
+    unsigned int num_threads, bool check_duplicates)
+{
+	/* Sanity check: Make sure that no two nodes are within tolerance of
+	 * each other: */
+	if (check_duplicates){
+		ensure_no_cloned_nodes(nodes, tolerance,
+		                       "delaunay_triangulation_hull()");
+	}
+
+	/* Triangulate all nodes: */
+	std::vector<size_t> ids(nodes.size());
+	for (size_t i=0; i<ids.size(); ++i){
+		ids[i] = i;
+	}
+	convex_hull_triangles(EuclidTable(nodes), ids, delaunay_triangles,
+	                      num_threads);
+}
+
+
+} // NAMESPACE ACOSA
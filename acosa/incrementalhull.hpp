@@ -0,0 +1,92 @@
+/* Randomized incremental convex hull algorithm for the Delaunay
+ * triangulation on a sphere. Part of ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Bibliography:
+ * [1] Nina Amenta, Dominique Attali, Olivier Devillers: Complexity of
+ *     Delaunay triangulation for points on lower-dimensional polyhedra,
+ *     in: Proceedings of the 18th ACM-SIAM Symposium on Discrete
+ *     Algorithms (2007), pp. 1106-1113
+ *     (biased randomized insertion order, BRIO)
+ * [2] Olivier Devillers, Sylvain Pion, Monique Teillaud: Walking in a
+ *     triangulation, in: International Journal of Foundations of
+ *     Computer Science 13 (2002), pp. 181-199
+ */
+
+#ifndef ACOSA_INCREMENTALHULL_HPP
+#define ACOSA_INCREMENTALHULL_HPP
+
+#include <basic_types.hpp>
+#include <spherics.hpp>
+#include <vector>
+
+namespace ACOSA {
+
+/*!
+ * \brief Calculates the Delaunay triangulation of a set of nodes on
+ *        a sphere as the convex hull of their unit vectors.
+ * \param nodes Vector of node coordinates. Should not contain any
+ *              duplicates (within tolerance). Otherwise, an
+ *              std::domain_error is thrown.
+ * \param delaunay_triangles Output vector of Delaunay triangles.
+ *                           Triangles are oriented counterclockwise
+ *                           when seen from outside the sphere, as in
+ *                           delaunay_triangulation_sphere.
+ * \param tolerance Tolerance used in the duplicate check.
+ * \param num_threads Number of threads used to sort the nodes into
+ *                    their insertion order. 0 selects the number of
+ *                    hardware threads. The result does not depend on
+ *                    it.
+ * \param check_duplicates If false, the nodes are not checked for
+ *                         duplicates (see
+ *                         delaunay_triangulation_sphere).
+ *
+ * The nodes are inserted into the hull one by one in a biased
+ * randomized insertion order [1] in which each round is sorted along
+ * a space-filling (Morton) curve. The hull faces visible from a new
+ * node are found by a walk [2] starting at the last created face.
+ * The expected complexity is O(N*log(N)).
+ *
+ * If all nodes lie on a common circle, an std::runtime_error is thrown.
+ */
+void delaunay_triangulation_hull(const std::vector<Node>& nodes,
+    std::vector<Triangle>& delaunay_triangles, double tolerance,
+    unsigned int num_threads = 0, bool check_duplicates = true);
+
+
+/*!
+ * \brief Calculates the convex hull of a subset of nodes using the
+ *        algorithm of delaunay_triangulation_hull.
+ * \param nodes Unit vectors of the nodes.
+ * \param ids Indices of the subset of nodes. At least four. No duplicate
+ *            check is done.
+ * \param triangles Output vector to which the hull's faces are appended,
+ *                  with indices referring to nodes.
+ * \param num_threads Number of threads used to sort the nodes (see
+ *                    delaunay_triangulation_hull).
+ *
+ * If the subset does not cover the sphere, the faces include those that
+ * are not Delaunay triangles of the subset (the hull's bottom faces).
+ * These can be identified by their orientation.
+ */
+void convex_hull_triangles(const EuclidTable& nodes,
+    const std::vector<size_t>& ids, std::vector<Triangle>& triangles,
+    unsigned int num_threads = 0);
+
+} // NAMESPACE ACOSA
+
+#endif // ACOSA_INCREMENTALHULL_HPP
@@ -0,0 +1,113 @@
+/* Helper functions for multi-threaded loops in ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACOSA_PARALLEL_HPP
+#define ACOSA_PARALLEL_HPP
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <exception>
+#include <algorithm>
+
+namespace ACOSA {
+
+/*!
+ * \brief The number of threads used if none is specified (0). This is
+ *        the number of hardware threads, or 1 if that is unknown.
+ */
+inline unsigned int thread_count(unsigned int num_threads = 0)
+{
+	if (num_threads == 0){
+		num_threads = std::thread::hardware_concurrency();
+	}
+	return std::max(num_threads, 1u);
+}
+
+
+/*!
+ * \brief Splits the range [0,n) into contiguous chunks and calls
+ *        f(chunk, begin, end) for each chunk in its own thread.
+ * \param n The size of the range.
+ * \param num_threads The number of chunks. It is reduced so that no
+ *                    chunk is empty. The first chunk is processed by
+ *                    the calling thread.
+ *
+ * The partition depends only on n and num_threads. If any call of f
+ * throws, the first exception is rethrown after all threads have
+ * finished.
+ */
+template<typename F>
+void parallel_chunks(size_t n, unsigned int num_threads, F f)
+{
+	if (num_threads > n){
+		num_threads = std::max<size_t>(n, 1);
+	}
+	if (num_threads <= 1){
+		f(0, 0, n);
+		return;
+	}
+
+	std::vector<std::exception_ptr> errors(num_threads);
+	auto run = [&](unsigned int chunk){
+		try {
+			f(chunk, (n*chunk)/num_threads, (n*(chunk+1))/num_threads);
+		} catch (...) {
+			errors[chunk] = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(num_threads-1);
+	for (unsigned int i=1; i<num_threads; ++i){
+		threads.emplace_back(run, i);
+	}
+	run(0);
+	for (std::thread& t : threads){
+		t.join();
+	}
+
+	for (const std::exception_ptr& e : errors){
+		if (e){
+			std::rethrow_exception(e);
+		}
+	}
+}
+
+
+/*!
+ * \brief Calls f(i) for each i in [0,n) using num_threads threads.
+ *
+ * Other than in parallel_chunks, the indices are handed out one at a
+ * time to the next idle thread. This balances items of very different
+ * cost, but f must not depend on which thread processes an index.
+ */
+template<typename F>
+void parallel_for(size_t n, unsigned int num_threads, F f)
+{
+	std::atomic<size_t> next(0);
+	parallel_chunks(std::min<size_t>(n, num_threads), num_threads,
+	    [&](unsigned int, size_t, size_t){
+		    for (size_t i = next++; i < n; i = next++){
+			    f(i);
+		    }
+	    });
+}
+
+} // NAMESPACE ACOSA
+
+#endif // ACOSA_PARALLEL_HPP
@@ -0,0 +1,396 @@
+/* Adaptive exact geometric predicates. Part of ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Bibliography:
+ * [1] Jonathan Richard Shewchuk: Adaptive Precision Floating-Point
+ *     Arithmetic and Fast Robust Geometric Predicates, in: Discrete &
+ *     Computational Geometry 18 (1997), pp. 305-363
+ */
+
+#include <predicates.hpp>
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+namespace ACOSA {
+
+/* Half the machine epsilon, i.e. the relative rounding error: */
+static constexpr double EPSILON = 0.5 * std::numeric_limits<double>::epsilon();
+
+/* Error bound of the floating point orient3d relative to the
+ * permanent ([1], o3derrboundA): */
+static constexpr double O3D_ERRBOUND = (7.0 + 56.0 * EPSILON) * EPSILON;
+
+/* Error bound of the floating point beach_side relative to its
+ * permanent, derived as o3derrboundA in [1]. Each of the two product
+ * terms A = (gx+gy)*dz passes through five roundings (the difference
+ * and product in gx and gy, their sum, the difference dz, and the
+ * product), so that |A' - A| <= ((1+eps)^5 - 1) * P_A with the exact
+ * permanent P_A = (|gx|+|gy|)*|dz|. The final difference adds a
+ * relative error of eps to the computed determinant, and the computed
+ * permanent passes through six roundings, P' >= (1-eps)^6 * P.
+ * The sign of the computed determinant D' is hence correct if
+ *    |D'| > ((1+eps)^5 - 1) / ((1-2eps) * (1-eps)^5) * P'
+ *         = (5*eps + 45*eps^2 + O(eps^3)) * P'
+ * which is covered by the following bound: */
+static constexpr double BEACH_ERRBOUND = (5.0 + 64.0 * EPSILON) * EPSILON;
+
+//######################################################################
+
+/*
+ * Expansion arithmetic of [1]: A number is represented exactly by the
+ * sum of doubles in increasing order of magnitude that do not overlap.
+ */
+class Expansion {
+	public:
+		Expansion(double d);
+
+		/* The exact difference a-b: */
+		static Expansion difference(double a, double b);
+
+		Expansion operator+(const Expansion& other) const;
+		Expansion operator-(const Expansion& other) const;
+		Expansion operator*(const Expansion& other) const;
+
+		/* The sign of the exact value, and an approximation: */
+		double estimate() const;
+
+	private:
+		Expansion() = default;
+
+		std::vector<double> c;
+
+		Expansion scale(double b) const;
+};
+
+
+//----------------------------------------------------------------------
+static inline void two_sum(double a, double b, double& x, double& y)
+{
+	x = a + b;
+	double bv = x - a;
+	double av = x - bv;
+	y = (a - av) + (b - bv);
+}
+
+//----------------------------------------------------------------------
+static inline void fast_two_sum(double a, double b, double& x, double& y)
+{
+	x = a + b;
+	y = b - (x - a);
+}
+
+//----------------------------------------------------------------------
+static inline void split(double a, double& hi, double& lo)
+{
+	/* Splitter 2^27+1 for 53 bit mantissas: */
+	double c = 134217729.0 * a;
+	double big = c - a;
+	hi = c - big;
+	lo = a - hi;
+}
+
+//----------------------------------------------------------------------
+static inline void two_product(double a, double b, double& x, double& y)
+{
+	x = a * b;
+	double ahi, alo, bhi, blo;
+	split(a, ahi, alo);
+	split(b, bhi, blo);
+	double err1 = x - (ahi * bhi);
+	double err2 = err1 - (alo * bhi);
+	double err3 = err2 - (ahi * blo);
+	y = (alo * blo) - err3;
+}
+
+
+//----------------------------------------------------------------------
+Expansion::Expansion(double d)
+{
+	if (d != 0.0){
+		c.push_back(d);
+	}
+}
+
+//----------------------------------------------------------------------
+Expansion Expansion::difference(double a, double b)
+{
+	Expansion e;
+	double x, y;
+	two_sum(a, -b, x, y);
+	if (y != 0.0){
+		e.c.push_back(y);
+	}
+	if (x != 0.0){
+		e.c.push_back(x);
+	}
+	return e;
+}
+
+//----------------------------------------------------------------------
+Expansion Expansion::operator+(const Expansion& other) const
+{
+	/* fast_expansion_sum_zeroelim of [1]: Merge the components by
+	 * magnitude and sum them up. */
+	const std::vector<double>& e = c;
+	const std::vector<double>& f = other.c;
+	if (e.empty()){
+		return other;
+	} else if (f.empty()){
+		return *this;
+	}
+
+	Expansion h;
+	h.c.reserve(e.size() + f.size());
+	size_t ei = 0, fi = 0;
+	double q, qnew, hh;
+	auto next = [&]() -> double {
+		if (fi == f.size() ||
+		    (ei < e.size() && std::abs(e[ei]) < std::abs(f[fi])))
+		{
+			return e[ei++];
+		}
+		return f[fi++];
+	};
+	q = next();
+	if (ei < e.size() || fi < f.size()){
+		double n = next();
+		fast_two_sum(n, q, qnew, hh);
+		q = qnew;
+		if (hh != 0.0){
+			h.c.push_back(hh);
+		}
+		while (ei < e.size() || fi < f.size()){
+			n = next();
+			two_sum(q, n, qnew, hh);
+			q = qnew;
+			if (hh != 0.0){
+				h.c.push_back(hh);
+			}
+		}
+	}
+	if (q != 0.0 || h.c.empty()){
+		h.c.push_back(q);
+	}
+	return h;
+}
+
+//----------------------------------------------------------------------
+Expansion Expansion::operator-(const Expansion& other) const
+{
+	Expansion neg(other);
+	for (double& d : neg.c){
+		d = -d;
+	}
+	return *this + neg;
+}
+
+//----------------------------------------------------------------------
+Expansion Expansion::scale(double b) const
+{
+	/* scale_expansion_zeroelim of [1]: */
+	Expansion h;
+	if (c.empty() || b == 0.0){
+		return h;
+	}
+	h.c.reserve(2 * c.size());
+	double q, sum, hh, product1, product0;
+	two_product(c[0], b, q, hh);
+	if (hh != 0.0){
+		h.c.push_back(hh);
+	}
+	for (size_t i=1; i<c.size(); ++i){
+		two_product(c[i], b, product1, product0);
+		two_sum(q, product0, sum, hh);
+		if (hh != 0.0){
+			h.c.push_back(hh);
+		}
+		fast_two_sum(product1, sum, q, hh);
+		if (hh != 0.0){
+			h.c.push_back(hh);
+		}
+	}
+	if (q != 0.0 || h.c.empty()){
+		h.c.push_back(q);
+	}
+	return h;
+}
+
+//----------------------------------------------------------------------
+Expansion Expansion::operator*(const Expansion& other) const
+{
+	Expansion h;
+	for (double d : other.c){
+		h = h + scale(d);
+	}
+	return h;
+}
+
+//----------------------------------------------------------------------
+double Expansion::estimate() const
+{
+	/* The largest component determines the sign: */
+	for (size_t i=c.size(); i>0; --i){
+		if (c[i-1] != 0.0){
+			return c[i-1];
+		}
+	}
+	return 0.0;
+}
+
+
+//######################################################################
+
+//----------------------------------------------------------------------
+static double orient3d_exact(const double pa[3], const double pb[3],
+                             const double pc[3], const double pd[3])
+{
+	Expansion adx = Expansion::difference(pa[0], pd[0]);
+	Expansion ady = Expansion::difference(pa[1], pd[1]);
+	Expansion adz = Expansion::difference(pa[2], pd[2]);
+	Expansion bdx = Expansion::difference(pb[0], pd[0]);
+	Expansion bdy = Expansion::difference(pb[1], pd[1]);
+	Expansion bdz = Expansion::difference(pb[2], pd[2]);
+	Expansion cdx = Expansion::difference(pc[0], pd[0]);
+	Expansion cdy = Expansion::difference(pc[1], pd[1]);
+	Expansion cdz = Expansion::difference(pc[2], pd[2]);
+
+	Expansion det = adx * (bdy * cdz - bdz * cdy)
+	              + bdx * (cdy * adz - cdz * ady)
+	              + cdx * (ady * bdz - adz * bdy);
+	return det.estimate();
+}
+
+//----------------------------------------------------------------------
+double orient3d(const double pa[3], const double pb[3], const double pc[3],
+                const double pd[3])
+{
+	double adx = pa[0] - pd[0], ady = pa[1] - pd[1], adz = pa[2] - pd[2];
+	double bdx = pb[0] - pd[0], bdy = pb[1] - pd[1], bdz = pb[2] - pd[2];
+	double cdx = pc[0] - pd[0], cdy = pc[1] - pd[1], cdz = pc[2] - pd[2];
+
+	double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+	double cdxady = cdx * ady, adxcdy = adx * cdy;
+	double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+	double det =   adz * (bdxcdy - cdxbdy)
+	             + bdz * (cdxady - adxcdy)
+	             + cdz * (adxbdy - bdxady);
+
+	double permanent =   (std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(adz)
+	                   + (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bdz)
+	                   + (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cdz);
+	double errbound = O3D_ERRBOUND * permanent;
+	if (det > errbound || -det > errbound){
+		return det;
+	}
+
+	return orient3d_exact(pa, pb, pc, pd);
+}
+
+
+//----------------------------------------------------------------------
+double incircle_sphere(const double pa[3], const double pb[3],
+                       const double pc[3], const double pd[3])
+{
+	return -orient3d(pa, pb, pc, pd);
+}
+
+
+//----------------------------------------------------------------------
+double beach_side(const double pa[3], const double pb[3], const double p[3])
+{
+	/* The circle through a site s that touches the sweep line at p
+	 * has its center on p's meridian at latitude phi given by
+	 *    tan(phi) = ((p-s).g) / (s_z - p_z),
+	 * where g is the horizontal direction of p. The smaller circle has
+	 * the larger phi. Both denominators are negative, so multiplying
+	 * them out gives the polynomial below. g=(p_x,p_y,0) is scaled by
+	 * the positive cos(lat) of p. */
+	double gax = (p[0] - pa[0]) * p[0], gay = (p[1] - pa[1]) * p[1];
+	double gbx = (p[0] - pb[0]) * p[0], gby = (p[1] - pb[1]) * p[1];
+	double dza = pa[2] - p[2];
+	double dzb = pb[2] - p[2];
+
+	double det = (gax + gay) * dzb - (gbx + gby) * dza;
+	double permanent =   (std::abs(gax) + std::abs(gay)) * std::abs(dzb)
+	                   + (std::abs(gbx) + std::abs(gby)) * std::abs(dza);
+	double errbound = BEACH_ERRBOUND * permanent;
+	if (det > errbound || -det > errbound){
+		return det;
+	}
+
+	Expansion px(p[0]), py(p[1]);
+	Expansion ga = Expansion::difference(p[0], pa[0]) * px
+	             + Expansion::difference(p[1], pa[1]) * py;
+	Expansion gb = Expansion::difference(p[0], pb[0]) * px
+	             + Expansion::difference(p[1], pb[1]) * py;
+	Expansion exact = ga * Expansion::difference(pb[2], p[2])
+	                - gb * Expansion::difference(pa[2], p[2]);
+	return exact.estimate();
+}
+
+
+//----------------------------------------------------------------------
+double circle_top_side(const double pa[3], const double pb[3],
+                       const double pc[3], double z)
+{
+	/* The circle is the intersection of the sphere with the plane
+	 * n*x = d. */
+	Expansion ux = Expansion::difference(pb[0], pa[0]);
+	Expansion uy = Expansion::difference(pb[1], pa[1]);
+	Expansion uz = Expansion::difference(pb[2], pa[2]);
+	Expansion wx = Expansion::difference(pc[0], pb[0]);
+	Expansion wy = Expansion::difference(pc[1], pb[1]);
+	Expansion wz = Expansion::difference(pc[2], pb[2]);
+	Expansion nx = uy * wz - uz * wy;
+	Expansion ny = uz * wx - ux * wz;
+	Expansion nz = ux * wy - uy * wx;
+	Expansion d = nx * Expansion(pa[0]) + ny * Expansion(pa[1])
+	            + nz * Expansion(pa[2]);
+
+	/* If the circle encloses the north pole (n_z > d), its maximum
+	 * latitude exceeds pi/2: */
+	double pole = (nz - d).estimate();
+	if (pole >= 0.0 && z < 1.0){
+		return 1.0;
+	} else if (pole >= 0.0){
+		return pole;
+	}
+
+	/* The plane z = const intersects the circle if its line of
+	 * intersection with the circle's plane is closer than 1 to the
+	 * origin, i.e. if (d - n_z*z)^2 < (1-z^2) * (n_x^2 + n_y^2): */
+	Expansion ze(z);
+	Expansion dz = d - nz * ze;
+	Expansion nxy = nx * nx + ny * ny;
+	double cross = (dz * dz - (Expansion(1.0) - ze * ze) * nxy).estimate();
+	if (cross < 0.0){
+		return 1.0;
+	}
+
+	/* Otherwise the circle lies on the side of its center d*n/|n|^2: */
+	Expansion norm = nxy + nz * nz;
+	double center = (d * nz - ze * norm).estimate();
+	if (center >= 0.0){
+		return 1.0;
+	}
+	return (cross > 0.0) ? -1.0 : 0.0;
+}
+
+} // NAMESPACE ACOSA
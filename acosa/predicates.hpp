@@ -0,0 +1,105 @@
+/* Adaptive exact geometric predicates. Part of ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Bibliography:
+ * [1] Jonathan Richard Shewchuk: Adaptive Precision Floating-Point
+ *     Arithmetic and Fast Robust Geometric Predicates, in: Discrete &
+ *     Computational Geometry 18 (1997), pp. 305-363
+ *
+ * The predicates first evaluate their polynomial in floating point
+ * arithmetic. Only if the result is smaller than a bound of its
+ * rounding error, the polynomial is evaluated exactly using the
+ * expansion arithmetic of [1]. The sign of the result is thus always
+ * exact for the given double precision coordinates.
+ *
+ * The exact arithmetic requires IEEE double precision without extended
+ * precision registers or fused multiply-adds of intermediate results
+ * (i.e. no -ffast-math or -ffp-contract=fast).
+ */
+
+#ifndef ACOSA_PREDICATES_HPP
+#define ACOSA_PREDICATES_HPP
+
+namespace ACOSA {
+
+/*!
+ * \brief Orientation of four points in space.
+ * \return A positive value if pd lies below the plane through pa, pb,
+ *         and pc, where below is defined so that pa, pb, and pc appear
+ *         counterclockwise when seen from above. Negative if pd lies
+ *         above, and zero if the four points are coplanar.
+ *
+ * This is the determinant of the matrix with rows pa-pd, pb-pd, and
+ * pc-pd, as orient3d in [1].
+ */
+double orient3d(const double pa[3], const double pb[3], const double pc[3],
+                const double pd[3]);
+
+
+/*!
+ * \brief Circle test for four points on the unit sphere.
+ * \return A positive value if pd lies inside the circumcircle of pa, pb,
+ *         and pc, which are counterclockwise when seen from outside the
+ *         sphere. Negative if it lies outside and zero if the four
+ *         points are cocircular.
+ *
+ * For points on a sphere, the insphere test of [1] reduces to the
+ * orientation of the plane through the circle, so this is -orient3d.
+ */
+double incircle_sphere(const double pa[3], const double pb[3],
+                       const double pc[3], const double pd[3]);
+
+
+/*!
+ * \brief Which of two sites lies closer to a new site of the sweep.
+ * \param pa First site, processed before p (i.e. of lower latitude).
+ * \param pb Second site, processed before p.
+ * \param p  The new site.
+ * \return A positive value if the beach arc of pa lies above p (i.e.
+ *         the circle through pa that touches the sweep line at p is
+ *         smaller than that through pb), negative if the arc of pb
+ *         does, and zero if p lies on the arcs' intersection.
+ *
+ * In terms of the beach, if pa is the left and pb the right neighbour,
+ * a positive value means that p lies left of their intersection.
+ */
+double beach_side(const double pa[3], const double pb[3], const double p[3]);
+
+
+/*!
+ * \brief Position of the top of a circle relative to a sweep line.
+ * \param pa First point on the circle.
+ * \param pb Second point on the circle.
+ * \param pc Third point on the circle.
+ * \param z Third coordinate (sine of the latitude) of the sweep line.
+ * \return A positive value if the maximum latitude of the circle lies
+ *         above the sweep line, negative if it lies below, and zero if
+ *         the circle touches the sweep line from below.
+ *
+ * The maximum latitude of the circle is that of its center
+ * (pb-pa) x (pc-pb) plus its radius. If that exceeds pi/2, the circle
+ * lies above every sweep line but the pole.
+ * The points are assumed to lie on the unit sphere. The test is always
+ * evaluated exactly and should hence only be used if the latitudes
+ * cannot be separated by floating point arithmetic.
+ */
+double circle_top_side(const double pa[3], const double pb[3],
+                       const double pc[3], double z);
+
+} // NAMESPACE ACOSA
+
+#endif // ACOSA_PREDICATES_HPP
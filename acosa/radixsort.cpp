@@ -0,0 +1,115 @@
+/* Radix sort of floating point keys used in ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <radixsort.hpp>
+#include <parallel.hpp>
+
+#include <array>
+#include <cstring>
+
+namespace ACOSA {
+
+//----------------------------------------------------------------------
+uint64_t radix_key(double d)
+{
+	/* Map -0.0 to 0.0: */
+	d += 0.0;
+
+	uint64_t bits;
+	std::memcpy(&bits, &d, sizeof(double));
+
+	/* Negative numbers are ordered reversely and before the positive
+	 * numbers: */
+	constexpr uint64_t SIGN = uint64_t(1) << 63;
+	if (bits & SIGN){
+		return ~bits;
+	}
+	return bits | SIGN;
+}
+
+
+//----------------------------------------------------------------------
+void radix_sort(std::vector<key_index_t>& data, unsigned int num_threads)
+{
+	std::vector<key_index_t> buffer;
+	radix_sort(data, buffer, num_threads);
+}
+
+//----------------------------------------------------------------------
+void radix_sort(std::vector<key_index_t>& data,
+                std::vector<key_index_t>& buffer, unsigned int num_threads)
+{
+	/* Below this size, the overhead of threads is not worth it: */
+	constexpr size_t MIN_PARALLEL_SIZE = 1 << 16;
+
+	const size_t N = data.size();
+	num_threads = (N < MIN_PARALLEL_SIZE) ? 1 : thread_count(num_threads);
+	if (num_threads > N){
+		num_threads = std::max<size_t>(N, 1);
+	}
+
+	typedef std::array<size_t,256> histogram_t;
+	std::vector<histogram_t> counts(num_threads);
+	buffer.resize(N);
+
+	/* One pass per byte, starting with the least significant: */
+	for (unsigned int shift=0; shift<64; shift += 8){
+		/* Count the digits of each thread's chunk: */
+		parallel_chunks(N, num_threads,
+			[&](unsigned int t, size_t begin, size_t end){
+				histogram_t& c = counts[t];
+				c.fill(0);
+				for (size_t i=begin; i<end; ++i){
+					++c[(data[i].key >> shift) & 0xFF];
+				}
+			});
+
+		/* Determine the offset of each chunk's digits in the output.
+		 * Skip the pass if all keys share the digit: */
+		bool trivial = false;
+		size_t offset = 0;
+		for (size_t digit=0; digit<256; ++digit){
+			size_t total = 0;
+			for (unsigned int t=0; t<num_threads; ++t){
+				size_t c = counts[t][digit];
+				counts[t][digit] = offset;
+				offset += c;
+				total += c;
+			}
+			if (total == N){
+				trivial = true;
+				break;
+			}
+		}
+		if (trivial){
+			continue;
+		}
+
+		/* Scatter. Each chunk is traversed in order, so the sort is
+		 * stable: */
+		parallel_chunks(N, num_threads,
+			[&](unsigned int t, size_t begin, size_t end){
+				histogram_t& c = counts[t];
+				for (size_t i=begin; i<end; ++i){
+					buffer[c[(data[i].key >> shift) & 0xFF]++] = data[i];
+				}
+			});
+		data.swap(buffer);
+	}
+}
+
+} // NAMESPACE ACOSA
@@ -0,0 +1,69 @@
+/* Radix sort of floating point keys used in ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACOSA_RADIXSORT_HPP
+#define ACOSA_RADIXSORT_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace ACOSA {
+
+/*!
+ * \brief A sort key and the index of the element it belongs to.
+ */
+struct key_index_t {
+	uint64_t key;
+	size_t   index;
+};
+
+
+/*!
+ * \brief Maps a double to an unsigned integer such that the order of
+ *        the integers is the order of the doubles.
+ *
+ * Both zeros are mapped to the same key. NaNs are not supported.
+ */
+uint64_t radix_key(double d);
+
+
+/*!
+ * \brief Sorts by key in ascending order using a least significant digit
+ *        radix sort.
+ * \param data The elements to sort.
+ * \param num_threads Number of threads to use. If 0, the number of
+ *                    hardware threads is used.
+ *
+ * The sort is stable and its result does not depend on the number of
+ * threads.
+ */
+void radix_sort(std::vector<key_index_t>& data,
+                unsigned int num_threads = 0);
+
+
+/*!
+ * \brief Same as above, but uses the given buffer (resized to the size
+ *        of data) instead of allocating one.
+ */
+void radix_sort(std::vector<key_index_t>& data,
+                std::vector<key_index_t>& buffer,
+                unsigned int num_threads = 0);
+
+} // NAMESPACE ACOSA
+
+#endif // ACOSA_RADIXSORT_HPP
@@ -369,4 +369,45 @@ SphereVectorEuclid::circumcenter(const SphereVectorEuclid& v1,
 	return v;
 }
 
+
+/* ****************************************************************** */
+/*                           EuclidTable                              */
+/* ****************************************************************** */
+
+EuclidTable::EuclidTable()
+{
+}
+
+EuclidTable::EuclidTable(const std::vector<Node>& nodes)
+{
+	assign(nodes);
+}
+
+void EuclidTable::assign(const std::vector<Node>& nodes)
+{
+	x.resize(nodes.size());
+	y.resize(nodes.size());
+	z.resize(nodes.size());
+	lat.resize(nodes.size());
+	for (size_t i=0; i<nodes.size(); ++i){
+		double clat = std::cos(nodes[i].lat);
+		x[i] = std::cos(nodes[i].lon)*clat;
+		y[i] = std::sin(nodes[i].lon)*clat;
+		z[i] = std::sin(nodes[i].lat);
+		lat[i] = nodes[i].lat;
+	}
+}
+
+EuclidTable::EuclidTable(const EuclidTable& table,
+                         const std::vector<size_t>& ids)
+	: x(ids.size()), y(ids.size()), z(ids.size()), lat(ids.size())
+{
+	for (size_t i=0; i<ids.size(); ++i){
+		x[i] = table.x[ids[i]];
+		y[i] = table.y[ids[i]];
+		z[i] = table.z[ids[i]];
+		lat[i] = table.lat[ids[i]];
+	}
+}
+
 } // NAMESPACE ACOSA
@@ -26,6 +26,7 @@
 #define ACOSA_SPHERICS_HPP
 
 #include <basic_types.hpp>
+#include <vector>
 
 namespace ACOSA {
 
@@ -146,6 +147,29 @@ SphereVectorEuclid operator*(double d, const SphereVectorEuclid& v);
 
 //######################################################################
 
+/*!
+ * \brief Euclidean coordinates and latitudes of a set of nodes, stored
+ *        as a structure of arrays indexed by node id.
+ */
+struct EuclidTable {
+	EuclidTable();
+
+	EuclidTable(const std::vector<Node>& nodes);
+
+	/* Refill the table, reusing its capacity: */
+	void assign(const std::vector<Node>& nodes);
+
+	/* The subset of a table given by ids, in that order: */
+	EuclidTable(const EuclidTable& table, const std::vector<size_t>& ids);
+
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> z;
+	std::vector<double> lat;
+};
+
+//######################################################################
+
 } // NAMESPACE ACOSA
 
 #endif // SPHERICS_HPP
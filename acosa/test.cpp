@@ -16,6 +16,8 @@
  */
 
 #include <vdtesselation.hpp>
+#include <workspace.hpp>
+#include <geometricgraph.hpp>
 #include <convexhull.hpp>
 #include <order_parameter.hpp>
 #include <alphaspectrum.hpp>
@@ -31,6 +33,10 @@
 #include <cstdlib>
 #include <list>
 #include <chrono>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
 
 
 const size_t N = 1000000;
@@ -61,23 +67,33 @@ struct configuration {
 	bool r_selected;
 	bool    scaled_dbg_output;
 	std::string testfile;
+	ACOSA::VDTesselation::delaunay_algorithm_t algorithm;
+	unsigned int threads;
+	bool   thread_scaling;
+	bool   test_merge;
+	bool   test_topology;
+	bool   test_workspace;
+	bool   test_graph;
 };
 
 
 static configuration get_config(int argc, char **argv){
-	configuration conf = {0,  1, false, false, 0, 0, false, false};
+	configuration conf = {0,  1, false, false, 0, 0, false, false, "",
+	                      ACOSA::VDTesselation::FORTUNES, 0, false, false, false, false, false};
 	
 	char *Nvalue = nullptr;
 	char *Rvalue = nullptr;
 	char *rvalue = nullptr;
 	char *gridtype = nullptr;
 	char *file = nullptr;
+	char *algorithm = nullptr;
+	char *threads = nullptr;
 	int index;
 	int c;
 
 	opterr = 0;
 
-	while ((c = getopt (argc, argv, "R:ON:r:G:Df:")) != -1){
+	while ((c = getopt (argc, argv, "R:ON:r:G:Df:A:T:SMCWg")) != -1){
 		switch (c)
 		{
 			case 'r':
@@ -105,6 +121,34 @@ static configuration get_config(int argc, char **argv){
 				Nvalue = optarg;
 				std::cout << "Nvalue: '" << Nvalue << "'\n";
 				break;
+			case 'A':
+				algorithm = optarg;
+				std::cout << "Using algorithm " << algorithm << ".\n";
+				break;
+			case 'T':
+				threads = optarg;
+				std::cout << "Using " << threads << " threads.\n";
+				break;
+			case 'S':
+				conf.thread_scaling = true;
+				std::cout << "Benchmarking thread scaling!\n";
+				break;
+			case 'M':
+				conf.test_merge = true;
+				std::cout << "Testing the merge of duplicate nodes!\n";
+				break;
+			case 'C':
+				conf.test_topology = true;
+				std::cout << "Testing the topology check!\n";
+				break;
+			case 'W':
+				conf.test_workspace = true;
+				std::cout << "Testing the reuse of a workspace!\n";
+				break;
+			case 'g':
+				conf.test_graph = true;
+				std::cout << "Testing the geometric graph!\n";
+				break;
 			case 'f':
 				file = optarg;
 				std::cout << "Using test data file '" << file << "'\n";
@@ -121,7 +165,8 @@ static configuration get_config(int argc, char **argv){
 					std::cerr << "Unknown option character '"
 							  << (char)optopt  << "'\n";
 			default:
-				return {0,  1, false, false, 0, 0, false, false};
+				return {0,  1, false, false, 0, 0, false, false, "",
+				        ACOSA::VDTesselation::FORTUNES, 0, false, false, false, false, false};
 		}
 	}
 	if (Nvalue){
@@ -137,6 +182,13 @@ static configuration get_config(int argc, char **argv){
 	if (gridtype){
 		conf.grid_type = std::atoi(gridtype);
 	}
+	if (algorithm){
+		conf.algorithm = static_cast<ACOSA::VDTesselation::delaunay_algorithm_t>
+		                     (std::atoi(algorithm));
+	}
+	if (threads){
+		conf.threads = std::atoi(threads);
+	}
 	return conf;
 }
 
@@ -186,6 +238,627 @@ void test_order_parameter(size_t N) {
 }
 
 
+/*!
+ * This method benchmarks the DIVIDE_AND_CONQUER algorithm using 1 to
+ * max_threads threads and checks that each result equals the
+ * single-threaded one.
+ */
+static void test_thread_scaling(const std::vector<ACOSA::Node>& nodes,
+                                unsigned int max_threads)
+{
+	if (max_threads == 0){
+		max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	std::vector<ACOSA::Triangle> reference;
+	double t_serial = 0.0;
+	for (unsigned int t=1; t<=max_threads; ++t){
+		auto t1 = std::chrono::high_resolution_clock::now();
+		ACOSA::VDTesselation tesselation(&nodes, 1e-10,
+		                        ACOSA::VDTesselation::DIVIDE_AND_CONQUER,
+		                        ACOSA::VDTesselation::CHECK_NOTHING, true, t);
+		auto t2 = std::chrono::high_resolution_clock::now();
+		double elapsed = std::chrono::duration<double>(t2 - t1).count();
+
+		const std::vector<ACOSA::Triangle>& triangles
+		    = tesselation.delaunay_triangles();
+		bool identical = true;
+		if (t == 1){
+			reference = triangles;
+			t_serial = elapsed;
+		} else {
+			identical = triangles.size() == reference.size();
+			for (size_t i=0; identical && i<triangles.size(); ++i){
+				identical = triangles[i].i == reference[i].i &&
+				            triangles[i].j == reference[i].j &&
+				            triangles[i].k == reference[i].k;
+			}
+		}
+		std::cout << "  threads=" << t << "  elapsed: " << elapsed
+		          << "s  speedup: " << t_serial / elapsed
+		          << (identical ? "" : "  RESULT DIFFERS!") << "\n";
+		if (!identical){
+			throw std::runtime_error("Multi-threaded triangulation differs "
+			                         "from single-threaded one.");
+		}
+	}
+}
+
+
+/*!
+ * This method tests the merge of duplicate nodes. It appends exact
+ * copies and copies shifted within tolerance of some nodes to the
+ * nodes, and checks that merged_nodes() maps each copy to its
+ * original, and that the triangulation equals that of the nodes
+ * without copies. Without merging, the copies have to be rejected.
+ */
+static void test_merge_duplicates(const std::vector<ACOSA::Node>& nodes,
+                                  ACOSA::VDTesselation::delaunay_algorithm_t
+                                      algorithm,
+                                  unsigned int threads,
+                                  std::mt19937_64& engine)
+{
+	const double tolerance = 1e-10;
+	const size_t N = nodes.size();
+	std::uniform_int_distribution<size_t> pick(0, N-1);
+	std::vector<ACOSA::Node> copies(nodes);
+	std::vector<size_t> source(N);
+	for (size_t i=0; i<N; ++i){
+		source[i] = i;
+	}
+	for (size_t k=0; k<N/10+1; ++k){
+		size_t i = pick(engine);
+		ACOSA::Node node = nodes[i];
+		if (k % 2){
+			/* Shift away from the closer pole: */
+			node.lat += (node.lat > 0.0) ? -0.25*tolerance
+			                             : 0.25*tolerance;
+		}
+		copies.push_back(node);
+		source.push_back(i);
+	}
+
+	ACOSA::VDTesselation reference(&nodes, tolerance, algorithm,
+	                               ACOSA::VDTesselation::CHECK_TOPOLOGY,
+	                               true, threads);
+	ACOSA::VDTesselation merged(&copies, tolerance, algorithm,
+	                            ACOSA::VDTesselation::CHECK_TOPOLOGY,
+	                            true, threads, true);
+
+	if (merged.merged_nodes() != source){
+		throw std::runtime_error("Merged nodes do not map the copies to "
+		                         "their originals.");
+	}
+	const std::vector<ACOSA::Triangle>& triangles
+	    = merged.delaunay_triangles();
+	const std::vector<ACOSA::Triangle>& expected
+	    = reference.delaunay_triangles();
+	bool identical = triangles.size() == expected.size();
+	for (size_t i=0; identical && i<triangles.size(); ++i){
+		identical = triangles[i].i == expected[i].i &&
+		            triangles[i].j == expected[i].j &&
+		            triangles[i].k == expected[i].k;
+	}
+	if (!identical){
+		throw std::runtime_error("Triangulation of merged nodes differs "
+		                         "from that of the original nodes.");
+	}
+
+	bool rejected = false;
+	try {
+		ACOSA::VDTesselation unmerged(&copies, tolerance, algorithm,
+		                              ACOSA::VDTesselation::CHECK_TOPOLOGY,
+		                              false, threads);
+	} catch (const std::domain_error&){
+		rejected = true;
+	}
+	if (!rejected){
+		throw std::runtime_error("Duplicate nodes have not been rejected.");
+	}
+	std::cout << "  merged " << copies.size() - N << " copies.\n";
+}
+
+
+/*!
+ * This method tests that CHECK_TOPOLOGY rejects a corrupted
+ * triangulation. On a regular grid, the BRUTE_FORCE algorithm returns
+ * all triangles of cocircular nodes, which overlap. The same grid is
+ * accepted if triangulated by the INCREMENTAL_HULL algorithm.
+ */
+static void test_topology_check()
+{
+	const size_t n_lon = 8, n_lat = 4;
+	std::vector<ACOSA::Node> nodes;
+	for (size_t j=0; j<n_lat; ++j){
+		for (size_t i=0; i<n_lon; ++i){
+			nodes.emplace_back(2*M_PI*((double)i)/n_lon,
+			                   -M_PI*(0.5-((double)j+1)/(n_lat+1)));
+		}
+	}
+
+	ACOSA::VDTesselation valid(&nodes, 1e-10,
+	                           ACOSA::VDTesselation::INCREMENTAL_HULL,
+	                           ACOSA::VDTesselation::CHECK_TOPOLOGY, false);
+
+	ACOSA::VDTesselation unchecked(&nodes, 1e-10,
+	                               ACOSA::VDTesselation::BRUTE_FORCE,
+	                               ACOSA::VDTesselation::CHECK_NOTHING,
+	                               false);
+	if (unchecked.delaunay_triangles().size() == 2*nodes.size() - 4){
+		throw std::runtime_error("BRUTE_FORCE triangulation of the grid "
+		                         "is not corrupted.");
+	}
+
+	bool rejected = false;
+	try {
+		ACOSA::VDTesselation checked(&nodes, 1e-10,
+		                             ACOSA::VDTesselation::BRUTE_FORCE,
+		                             ACOSA::VDTesselation::CHECK_TOPOLOGY,
+		                             false);
+	} catch (const std::runtime_error& err){
+		std::cout << "  rejected:\n" << err.what() << "\n";
+		rejected = true;
+	}
+	if (!rejected){
+		throw std::runtime_error("CHECK_TOPOLOGY accepted a corrupted "
+		                         "triangulation.");
+	}
+}
+
+
+/*!
+ * This method tests the reuse of a TesselationWorkspace. It builds
+ * a sequence of tesselations of different sizes with one workspace,
+ * recycling each, and checks that they equal tesselations built
+ * without a workspace.
+ */
+static void test_workspace_reuse(const std::vector<ACOSA::Node>& nodes,
+                                 ACOSA::VDTesselation::delaunay_algorithm_t
+                                     algorithm,
+                                 unsigned int threads)
+{
+	/* The nodes, half of them, the nodes with copies to merge, and the
+	 * nodes again: */
+	std::vector<ACOSA::Node> half(nodes.begin(),
+	                              nodes.begin() + nodes.size()/2);
+	std::vector<ACOSA::Node> copies(nodes);
+	copies.insert(copies.end(), nodes.begin(),
+	              nodes.begin() + nodes.size()/10);
+	const std::vector<ACOSA::Node>* sets[4] = {&nodes, &half, &copies,
+	                                           &nodes};
+
+	ACOSA::TesselationWorkspace workspace;
+	for (const std::vector<ACOSA::Node>* set : sets){
+		const bool merge = (set == &copies);
+		ACOSA::VDTesselation fresh(*set, 1e-10, algorithm,
+		                           ACOSA::VDTesselation::CHECK_TOPOLOGY,
+		                           true, threads, merge);
+		ACOSA::VDTesselation reused(*set, workspace, 1e-10, algorithm,
+		                            ACOSA::VDTesselation::CHECK_TOPOLOGY,
+		                            true, threads, merge);
+
+		const std::vector<ACOSA::Triangle>& t0 = fresh.delaunay_triangles();
+		const std::vector<ACOSA::Triangle>& t1 = reused.delaunay_triangles();
+		bool identical = t0.size() == t1.size()
+		    && fresh.merged_nodes() == reused.merged_nodes();
+		for (size_t i=0; identical && i<t0.size(); ++i){
+			identical = t0[i].i == t1[i].i && t0[i].j == t1[i].j &&
+			            t0[i].k == t1[i].k;
+		}
+		const std::vector<ACOSA::Node>& n0 = fresh.voronoi_nodes();
+		const std::vector<ACOSA::Node>& n1 = reused.voronoi_nodes();
+		identical = identical && n0.size() == n1.size();
+		for (size_t i=0; identical && i<n0.size(); ++i){
+			identical = n0[i].lon == n1[i].lon && n0[i].lat == n1[i].lat;
+		}
+		std::vector<ACOSA::Node> vn;
+		std::vector<ACOSA::Link> l0, l1;
+		fresh.voronoi_tesselation(vn, l0);
+		reused.voronoi_tesselation(vn, l1);
+		identical = identical && l0 == l1
+		    && fresh.voronoi_cell_areas() == reused.voronoi_cell_areas();
+		if (!identical){
+			throw std::runtime_error("Tesselation built with a reused "
+			                         "workspace differs from a fresh one.");
+		}
+		workspace.recycle(std::move(reused));
+		std::cout << "  N=" << set->size() << " identical, workspace holds "
+		          << workspace.bytes() << " bytes.\n";
+	}
+}
+
+
+/*!
+ * The links of a geometric graph, found by comparing all node pairs.
+ * Pairs whose distance is within rounding errors of sigma_0 may or
+ * may not be connected and are listed separately. Both lists are
+ * sorted and contain each pair once with i < j.
+ */
+struct brute_force_graph {
+	std::vector<ACOSA::Link> certain;
+	std::vector<ACOSA::Link> uncertain;
+};
+
+static brute_force_graph
+geometric_graph_brute_force(const std::vector<ACOSA::Node>& nodes,
+                            double sigma_0)
+{
+	const size_t N = nodes.size();
+	std::vector<double> x(N), y(N), z(N);
+	for (size_t i=0; i<N; ++i){
+		x[i] = std::cos(nodes[i].lat) * std::cos(nodes[i].lon);
+		y[i] = std::cos(nodes[i].lat) * std::sin(nodes[i].lon);
+		z[i] = std::sin(nodes[i].lat);
+	}
+
+	/* Compare the dot products with a margin far above the rounding
+	 * errors of both this and the tested computation: */
+	const double cos_sigma_0 = (sigma_0 <= 0.0) ? 2.0
+	                         : (sigma_0 > M_PI) ? -2.0
+	                         : std::cos(sigma_0);
+	const double margin = 1e-12;
+
+	brute_force_graph graph;
+	for (size_t i=0; i<N; ++i){
+		for (size_t j=i+1; j<N; ++j){
+			const double dot = x[i]*x[j] + y[i]*y[j] + z[i]*z[j];
+			if (dot > cos_sigma_0 + margin){
+				graph.certain.emplace_back(i, j);
+			} else if (dot >= cos_sigma_0 - margin){
+				graph.uncertain.emplace_back(i, j);
+			}
+		}
+	}
+	return graph;
+}
+
+
+/*!
+ * Checks that the links contain every certain link of the brute force
+ * graph, and no other pairs than uncertain ones. If symmetric, each
+ * pair has to be contained once in each direction, otherwise once in
+ * either direction.
+ */
+static void check_geometric_graph_links(const std::vector<ACOSA::Link>& links,
+                                        const brute_force_graph& reference,
+                                        bool symmetric,
+                                        const std::string& name)
+{
+	std::vector<ACOSA::Link> forward, backward;
+	for (const ACOSA::Link& link : links){
+		if (link.i == link.j){
+			throw std::runtime_error(name + " links a node to itself.");
+		}
+		if (link.i < link.j){
+			forward.push_back(link);
+		} else {
+			backward.emplace_back(link.j, link.i);
+		}
+	}
+	if (symmetric){
+		std::sort(forward.begin(), forward.end());
+		std::sort(backward.begin(), backward.end());
+		if (forward != backward){
+			throw std::runtime_error(name + " does not contain each link "
+			                         "in both directions.");
+		}
+	} else {
+		forward.insert(forward.end(), backward.begin(), backward.end());
+		std::sort(forward.begin(), forward.end());
+	}
+	if (std::adjacent_find(forward.begin(), forward.end()) != forward.end()){
+		throw std::runtime_error(name + " contains a link twice.");
+	}
+	if (!std::includes(forward.begin(), forward.end(),
+	                   reference.certain.begin(), reference.certain.end()))
+	{
+		throw std::runtime_error(name + " misses a link.");
+	}
+	std::vector<ACOSA::Link> extra;
+	std::set_difference(forward.begin(), forward.end(),
+	                    reference.certain.begin(), reference.certain.end(),
+	                    std::back_inserter(extra));
+	if (!std::includes(reference.uncertain.begin(),
+	                   reference.uncertain.end(),
+	                   extra.begin(), extra.end()))
+	{
+		throw std::runtime_error(name + " links too distant nodes.");
+	}
+}
+
+
+/*!
+ * This method tests geometric_graph_links with both algorithms
+ * against the brute force graph.
+ */
+static void test_geometric_graph_links(const std::vector<ACOSA::Node>& nodes,
+                                       double sigma_0,
+                                       const brute_force_graph& reference,
+                                       const std::vector<unsigned int>&
+                                           thread_counts)
+{
+	std::vector<ACOSA::Link> links;
+	ACOSA::geometric_graph_links(nodes, links, sigma_0,
+	                             ACOSA::GEOMETRIC_GRAPH_SWEEP);
+	check_geometric_graph_links(links, reference, true,
+	                            "GEOMETRIC_GRAPH_SWEEP");
+
+	for (unsigned int threads : thread_counts){
+		/* The links are appended: */
+		links.clear();
+		ACOSA::geometric_graph_links(nodes, links, sigma_0,
+		                             ACOSA::GEOMETRIC_GRAPH_BUCKETS,
+		                             threads);
+		check_geometric_graph_links(links, reference, true,
+		                            "GEOMETRIC_GRAPH_BUCKETS with "
+		                            + std::to_string(threads)
+		                            + " threads");
+	}
+}
+
+
+/*!
+ * Converts an adjacency in compressed sparse row format to links,
+ * checking that each node's neighbours are ascending.
+ */
+template<typename index_t>
+static std::vector<ACOSA::Link>
+adjacency_links(size_t N, const std::vector<size_t>& offsets,
+                const std::vector<index_t>& neighbours,
+                const std::string& name)
+{
+	if (offsets.size() != N+1 || offsets[0] != 0
+	    || offsets[N] != neighbours.size())
+	{
+		throw std::runtime_error(name + " has invalid offsets.");
+	}
+	std::vector<ACOSA::Link> links;
+	for (size_t i=0; i<N; ++i){
+		for (size_t k=offsets[i]; k<offsets[i+1]; ++k){
+			if (k > offsets[i] && neighbours[k] <= neighbours[k-1]){
+				throw std::runtime_error(name + " has neighbours that are "
+				                         "not ascending.");
+			}
+			links.emplace_back(i, neighbours[k]);
+		}
+	}
+	return links;
+}
+
+
+/*!
+ * This method tests geometric_graph_adjacency with 64, 32 and, if
+ * the nodes can be indexed by them, 16-bit indices against the brute
+ * force graph, and the distances against their exact values. The
+ * adjacency may not depend on the index type and the number of
+ * threads.
+ */
+static void test_geometric_graph_adjacency(
+    const std::vector<ACOSA::Node>& nodes, double sigma_0,
+    const brute_force_graph& reference,
+    const std::vector<unsigned int>& thread_counts)
+{
+	const size_t N = nodes.size();
+	std::vector<size_t> offsets, offsets_32, offsets_16;
+	std::vector<size_t> neighbours;
+	std::vector<uint32_t> neighbours_32;
+	std::vector<uint16_t> neighbours_16;
+	std::vector<float> distances;
+	ACOSA::geometric_graph_adjacency(nodes, offsets, neighbours, sigma_0,
+	                                 nullptr, 1);
+	check_geometric_graph_links(adjacency_links(N, offsets, neighbours,
+	                                            "Adjacency"),
+	                            reference, true, "Adjacency");
+
+	for (unsigned int threads : thread_counts){
+		const std::string name = "Adjacency with "
+		                         + std::to_string(threads) + " threads";
+		ACOSA::geometric_graph_adjacency(nodes, offsets_32, neighbours_32,
+		                                 sigma_0, &distances, threads);
+		adjacency_links(N, offsets_32, neighbours_32, name);
+		if (offsets_32 != offsets
+		    || !std::equal(neighbours.begin(), neighbours.end(),
+		                   neighbours_32.begin()))
+		{
+			throw std::runtime_error(name + " and 32-bit indices differs.");
+		}
+
+		/* Compare the distances with their exact values: */
+		if (distances.size() != neighbours.size()){
+			throw std::runtime_error(name + " has the wrong number of "
+			                         "distances.");
+		}
+		for (size_t i=0; i<N; ++i){
+			for (size_t k=offsets[i]; k<offsets[i+1]; ++k){
+				const ACOSA::Node& a = nodes[i];
+				const ACOSA::Node& b = nodes[neighbours[k]];
+				const double exact
+				    = std::acos(std::min(std::sin(a.lat) * std::sin(b.lat)
+				                + std::cos(a.lat) * std::cos(b.lat)
+				                  * std::cos(a.lon - b.lon), 1.0));
+				if (std::abs(distances[k] - exact) > 1e-6){
+					throw std::runtime_error(name + " has a wrong "
+					                         "distance.");
+				}
+			}
+		}
+
+		if (N <= std::numeric_limits<uint16_t>::max()){
+			ACOSA::geometric_graph_adjacency(nodes, offsets_16,
+			                                 neighbours_16, sigma_0,
+			                                 nullptr, threads);
+			if (offsets_16 != offsets
+			    || !std::equal(neighbours.begin(), neighbours.end(),
+			                   neighbours_16.begin()))
+			{
+				throw std::runtime_error(name + " and 16-bit indices "
+				                         "differs.");
+			}
+		}
+	}
+}
+
+
+/*!
+ * This method tests geometric_graph_visit against the brute force
+ * graph, and geometric_graph_degrees and geometric_graph_components
+ * against the visited links. For the components, the visited links are
+ * joined by a union-find structure and numbered in order of their
+ * first node. The results may not depend on the number of threads.
+ */
+static void test_geometric_graph_streaming(
+    const std::vector<ACOSA::Node>& nodes, double sigma_0,
+    const brute_force_graph& reference,
+    const std::vector<unsigned int>& thread_counts)
+{
+	const size_t N = nodes.size();
+	std::vector<ACOSA::Link> first_visit;
+	for (unsigned int threads : thread_counts){
+		const std::string name = " with " + std::to_string(threads)
+		                         + " threads";
+		std::vector<ACOSA::Link> visited;
+		ACOSA::geometric_graph_visit(nodes, sigma_0,
+		    [&](const std::vector<ACOSA::Link>& batch){
+			visited.insert(visited.end(), batch.begin(), batch.end());
+		}, threads);
+		check_geometric_graph_links(visited, reference, false,
+		                            "Visit" + name);
+		if (first_visit.empty()){
+			first_visit = visited;
+		} else if (visited != first_visit){
+			throw std::runtime_error("Visit" + name + " differs.");
+		}
+
+		/* Degrees: */
+		std::vector<size_t> expected(N, 0), degrees;
+		for (const ACOSA::Link& link : visited){
+			++expected[link.i];
+			++expected[link.j];
+		}
+		ACOSA::geometric_graph_degrees(nodes, degrees, sigma_0, threads);
+		if (degrees != expected){
+			throw std::runtime_error("Degrees" + name + " differ from the "
+			                         "visited links.");
+		}
+
+		/* Components: */
+		std::vector<size_t> root(N);
+		for (size_t i=0; i<N; ++i){
+			root[i] = i;
+		}
+		auto find = [&](size_t i){
+			while (root[i] != i){
+				i = root[i] = root[root[i]];
+			}
+			return i;
+		};
+		for (const ACOSA::Link& link : visited){
+			root[find(link.i)] = find(link.j);
+		}
+		std::vector<size_t> label(N, N), components;
+		size_t n_components = 0;
+		for (size_t i=0; i<N; ++i){
+			size_t& l = label[find(i)];
+			if (l == N){
+				l = n_components++;
+			}
+			expected[i] = l;
+		}
+		if (ACOSA::geometric_graph_components(nodes, components, sigma_0,
+		                                      threads)
+		    != n_components || components != expected)
+		{
+			throw std::runtime_error("Components" + name + " differ from "
+			                         "the visited links.");
+		}
+	}
+}
+
+
+/*!
+ * This method tests that geometric_graph_adjacency rejects nodes that
+ * cannot be indexed by the requested index type, and accepts one node
+ * less. The nodes are spaced evenly along the equator and connected to
+ * their two neighbours.
+ */
+static void test_geometric_graph_adjacency_overflow()
+{
+	for (size_t N : {(size_t)std::numeric_limits<uint16_t>::max() + 1,
+	                 (size_t)std::numeric_limits<uint16_t>::max()})
+	{
+		std::vector<ACOSA::Node> nodes(N);
+		for (size_t i=0; i<N; ++i){
+			nodes[i] = ACOSA::Node(2*M_PI*((double)i)/N, 0.0);
+		}
+		std::vector<size_t> offsets;
+		std::vector<uint16_t> neighbours;
+		try {
+			ACOSA::geometric_graph_adjacency(nodes, offsets, neighbours,
+			                                 3*M_PI/N);
+		} catch (const std::domain_error&){
+			if (N <= std::numeric_limits<uint16_t>::max()){
+				throw;
+			}
+			continue;
+		}
+		if (N > std::numeric_limits<uint16_t>::max()){
+			throw std::runtime_error("Adjacency with too many nodes for "
+			                         "the index type has not been "
+			                         "rejected.");
+		}
+		if (offsets[N] != 2*N || neighbours[offsets[N-1]] != 0
+		    || neighbours[offsets[N-1]+1] != N-2)
+		{
+			throw std::runtime_error("Adjacency with 16-bit indices is "
+			                         "wrong.");
+		}
+	}
+}
+
+
+/*!
+ * This method tests the geometric graph functions against a brute
+ * force comparison of all node pairs, which takes O(N^2) time. The
+ * thresholds are chosen for mean degrees of about 4, 32 and 256, and
+ * as the distance of the first node to its closest neighbour. On a
+ * regular grid, the latter is the distance between neighbours in the
+ * southernmost row, so that many node pairs lie at the threshold.
+ */
+static void test_geometric_graph(const std::vector<ACOSA::Node>& nodes,
+                                 unsigned int threads)
+{
+	const size_t N = nodes.size();
+	if (N < 2){
+		throw std::runtime_error("The geometric graph test needs at least "
+		                         "two nodes.");
+	}
+	double dot = -1.0;
+	for (size_t i=1; i<N; ++i){
+		dot = std::max(dot, std::cos(nodes[0].lat) * std::cos(nodes[i].lat)
+		                    * std::cos(nodes[0].lon - nodes[i].lon)
+		                    + std::sin(nodes[0].lat) * std::sin(nodes[i].lat));
+	}
+	const double sigma_0[] = {0.0, 4.0/std::sqrt(N), 2.0*std::sqrt(32.0/N),
+	                          32.0/std::sqrt(N),
+	                          std::acos(std::min(std::max(dot, -1.0), 1.0))};
+	const std::vector<unsigned int> thread_counts = {1, 2, threads};
+
+	for (double s : sigma_0){
+		const brute_force_graph reference
+		    = geometric_graph_brute_force(nodes, s);
+
+		test_geometric_graph_links(nodes, s, reference, thread_counts);
+		test_geometric_graph_adjacency(nodes, s, reference, thread_counts);
+		test_geometric_graph_streaming(nodes, s, reference, thread_counts);
+
+		std::cout << "  sigma_0=" << s << ": " << reference.certain.size()
+		          << " links and " << reference.uncertain.size()
+		          << " at the threshold checked.\n";
+	}
+
+	test_geometric_graph_adjacency_overflow();
+}
+
+
 /*!
  * \brief longitude_grid_points
  * \param N
@@ -362,9 +1035,28 @@ static std::vector<ACOSA::Node> read_data_file(const std::string& filename)
  *          x=1: Grid is (near) hexagonal in lon/lat space (every
  *               second line is shifted by half a grid distance
  *               in longitude).
+ * "-A x" : Selects the Delaunay triangulation algorithm:
+ *          x=0: Fortune's algorithm (default).
+ *          x=1: Brute force.
+ *          x=2: Incremental convex hull.
+ *          x=3: Multi-threaded divide and conquer.
+ * "-T x" : Use x threads in multi-threaded algorithms (default: number
+ *          of hardware threads).
+ * "-S"   : Instead of the full test, benchmark the multi-threaded
+ *          algorithm for each thread count from 1 to the one selected
+ *          by "-T" and check that all results are identical.
+ * "-M"   : Instead of the full test, check the merge of duplicate
+ *          nodes (see test_merge_duplicates).
+ * "-W"   : Instead of the full test, check that tesselations built
+ *          with a reused workspace equal fresh ones.
+ * "-g"   : Instead of the full test, check the geometric graph
+ *          functions against a brute force search for the thread
+ *          counts 1, 2, and the one selected by "-T".
  * "-D"   : Print debug output that scales with N.
  * "-O"   : A different test mode is chosen where the OrderParameter
  *          class is tested.
+ * "-C"   : A different test mode is chosen where CHECK_TOPOLOGY is
+ *          tested on a corrupted triangulation.
  */
 int main(int argc, char **argv){
 	/* Parse command line argument: */
@@ -378,6 +1070,11 @@ int main(int argc, char **argv){
 		test_order_parameter(c.N);
 		return 0;
 	}
+
+	if (c.test_topology){
+		test_topology_check();
+		return 0;
+	}
 	
 	
 	size_t N = c.N;
@@ -436,10 +1133,33 @@ int main(int argc, char **argv){
 			continue;
 		}
 		
+		if (c.thread_scaling){
+			test_thread_scaling(nodes, c.threads);
+			continue;
+		}
+
+		if (c.test_merge){
+			test_merge_duplicates(nodes, c.algorithm, c.threads, engine);
+			continue;
+		}
+
+		if (c.test_workspace){
+			test_workspace_reuse(nodes, c.algorithm, c.threads);
+			continue;
+		}
+
+		if (c.test_graph){
+			test_geometric_graph(nodes, c.threads);
+			continue;
+		}
+
 		/* Create tesselation: */
 		std::cout << "Create tesselation.\n";
 		auto t1 = std::chrono::high_resolution_clock::now();
-		ACOSA::VDTesselation tesselation(nodes);
+		ACOSA::VDTesselation tesselation(&nodes, 1e-10, c.algorithm,
+		                     ACOSA::VDTesselation::CHECK_DUAL_LINKS |
+		                     ACOSA::VDTesselation::CHECK_VORONOI_CELL_AREAS,
+		                     true, c.threads);
 		auto t2 = std::chrono::high_resolution_clock::now();
 		std::cout << "  --> elapsed: "
 		          << std::chrono::duration_cast<std::chrono::seconds>(t2 - t1)
@@ -500,6 +1220,22 @@ int main(int argc, char **argv){
 		std::cout << "alpha shape for alpha=" << alpha<< ":\n  - node count: "
 		          << shape.nodes().size() << "\n  - link count: "
 		          << shape.links().size() << "\n";
+
+		/* Statistics of the tesselation: */
+		ACOSA::VDTesselation::statistics_t stats = tesselation.statistics();
+		std::cout << "Statistics:\n"
+		             "  - triangulation:   " << stats.time_triangulation << "s\n"
+		             "  - checks:          " << stats.time_checks << "s\n"
+		             "  - merge clusters:  " << stats.time_merge_clusters
+		          << "s\n"
+		             "  - Voronoi network: " << stats.time_voronoi_network
+		          << "s\n"
+		             "  - dual links:      " << stats.time_dual_links << "s\n"
+		             "  - peak beach size: " << stats.peak_beach_size << "\n"
+		             "  - circle events (pushed / invalidated / processed): "
+		          << stats.circle_events_pushed << " / "
+		          << stats.circle_events_invalidated << " / "
+		          << stats.circle_events_processed << "\n";
 	
 	}
 		
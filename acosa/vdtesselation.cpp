@@ -27,14 +27,20 @@
 #include <vdtesselation.hpp>
 #include <spherics.hpp>
 #include <fortunes_sphere.hpp>
+#include <incrementalhull.hpp>
+#include <divideconquer.hpp>
 #include <geometricgraph.hpp>
+#include <halfedge.hpp>
+#include <parallel.hpp>
+#include <workspace.hpp>
 
 #include <map>
-#include <set>
 #include <unordered_map>
 #include <iostream>
 #include <math.h>
 #include <algorithm>
+#include <utility>
+#include <chrono>
 
 namespace ACOSA {
 
@@ -44,10 +50,20 @@ static constexpr unsigned char VORONOI_NODES_CACHED =  2;
 static constexpr unsigned char VORONOI_LINKS_CACHED =  4;
 static constexpr unsigned char VORONOI_CELLS_CACHED =  8;
 static constexpr unsigned char DUAL_LINKS_CACHED    = 16;
+static constexpr unsigned char HALF_EDGES_CACHED    = 32;
+static constexpr unsigned char NODE_TRIANGLES_CACHED = 64;
 
 static constexpr unsigned char ALL_CACHED = 0xFF;
 
 
+/* Wall time in seconds since a time point: */
+static double seconds_since(const std::chrono::steady_clock::time_point& t0)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now()
+	                                     - t0).count();
+}
+
+
 static void
 delaunay_triangulation_brute_force(const std::vector<Node>& nodes,
                                    std::vector<Triangle>& triangles,
@@ -111,7 +127,7 @@ delaunay_triangulation_brute_force(const std::vector<Node>& nodes,
 static void tesselation_N3(const Node& n1, const Node& n2, const Node& n3,
                            std::vector<Triangle>& delaunay_triangles,
                            std::vector<size_t>& delaunay2voronoi,
-                           std::vector<std::forward_list<size_t>>& voronoi2delaunay,
+                           CSRIncidence& voronoi2delaunay,
                            std::vector<Link>& delaunay_links,
                            std::vector<size_t>& dual_link_delaunay2voronoi,
                            std::vector<Node>& voronoi_nodes,
@@ -132,9 +148,7 @@ static void tesselation_N3(const Node& n1, const Node& n2, const Node& n3,
 	/* Maps between Voronoi and Delaunay: */
 	delaunay2voronoi.push_back(0);
 	delaunay2voronoi.push_back(1);
-	voronoi2delaunay.resize(2);
-	voronoi2delaunay[0].push_front(0);
-	voronoi2delaunay[1].push_front(1);
+	voronoi2delaunay = CSRIncidence::inverse(delaunay2voronoi, 2);
 	dual_link_delaunay2voronoi.resize(delaunay_links.size(), ACOSA::NO_LINK);
 
 	/* Voronoi areas: Calculate longitude of nodes in a coordinate system */
@@ -175,9 +189,139 @@ static void tesselation_N3(const Node& n1, const Node& n2, const Node& n3,
 VDTesselation::VDTesselation(const std::vector<Node>& nodes,
 							 double tolerance,
 							 delaunay_algorithm_t algorithm,
-							 int checks, bool on_error_display_nodes)
-    : nodes(nodes), cache_state(0), N(nodes.size()), tolerance(tolerance)
+							 int checks, bool on_error_display_nodes,
+							 unsigned int num_threads, bool merge_duplicates)
+    : VDTesselation(prepare_nodes(nodes, tolerance, merge_duplicates),
+                    tolerance, algorithm, checks, on_error_display_nodes,
+                    num_threads, nullptr)
+{
+}
+
+//------------------------------------------------------------------------------
+VDTesselation::node_set_t
+VDTesselation::prepare_nodes(const std::vector<Node>& nodes,
+                             double tolerance, bool merge_duplicates)
+{
+	node_set_t node_set;
+	if (merge_duplicates){
+		merge_cloned_nodes(nodes, tolerance, node_set.nodes,
+		                   node_set.merged);
+	} else {
+		node_set.nodes = nodes;
+	}
+	return node_set;
+}
+
+//------------------------------------------------------------------------------
+VDTesselation::VDTesselation(std::vector<Node>&& nodes,
+                             double tolerance,
+                             delaunay_algorithm_t algorithm,
+                             int checks, bool on_error_display_nodes,
+                             unsigned int num_threads, bool merge_duplicates)
+    : VDTesselation(prepare_nodes(std::move(nodes), tolerance,
+                                  merge_duplicates),
+                    tolerance, algorithm, checks, on_error_display_nodes,
+                    num_threads, nullptr)
+{
+}
+
+//------------------------------------------------------------------------------
+VDTesselation::node_set_t
+VDTesselation::prepare_nodes(std::vector<Node>&& nodes,
+                             double tolerance, bool merge_duplicates)
+{
+	node_set_t node_set;
+	if (merge_duplicates){
+		merge_cloned_nodes(nodes, tolerance, node_set.nodes,
+		                   node_set.merged);
+	} else {
+		node_set.nodes = std::move(nodes);
+	}
+	return node_set;
+}
+
+//------------------------------------------------------------------------------
+VDTesselation::VDTesselation(const std::vector<Node>* nodes,
+                             double tolerance,
+                             delaunay_algorithm_t algorithm,
+                             int checks, bool on_error_display_nodes,
+                             unsigned int num_threads, bool merge_duplicates)
+    : VDTesselation(prepare_nodes(nodes, tolerance, merge_duplicates),
+                    tolerance, algorithm, checks, on_error_display_nodes,
+                    num_threads, nullptr)
+{
+}
+
+//------------------------------------------------------------------------------
+VDTesselation::node_set_t
+VDTesselation::prepare_nodes(const std::vector<Node>* nodes,
+                             double tolerance, bool merge_duplicates)
+{
+	if (!nodes){
+		throw std::runtime_error("ERROR : VDTesselation() :\nThe "
+		                         "borrowed nodes are null.\n");
+	}
+	node_set_t node_set;
+	if (merge_duplicates){
+		merge_cloned_nodes(*nodes, tolerance, node_set.nodes,
+		                   node_set.merged);
+	} else {
+		node_set.borrowed = nodes;
+	}
+	return node_set;
+}
+
+//------------------------------------------------------------------------------
+VDTesselation::VDTesselation(const std::vector<Node>& nodes,
+                             TesselationWorkspace& workspace,
+                             double tolerance,
+                             delaunay_algorithm_t algorithm,
+                             int checks, bool on_error_display_nodes,
+                             unsigned int num_threads, bool merge_duplicates)
+    : VDTesselation(prepare_nodes(nodes, workspace, tolerance,
+                                  merge_duplicates),
+                    tolerance, algorithm, checks, on_error_display_nodes,
+                    num_threads, &workspace)
 {
+}
+
+//------------------------------------------------------------------------------
+VDTesselation::node_set_t
+VDTesselation::prepare_nodes(const std::vector<Node>& nodes,
+                             TesselationWorkspace& workspace,
+                             double tolerance, bool merge_duplicates)
+{
+	/* Copy the nodes into the workspace's node buffer: */
+	node_set_t node_set;
+	node_set.nodes.swap(workspace.nodes);
+	if (merge_duplicates){
+		merge_cloned_nodes(nodes, tolerance, node_set.nodes,
+		                   node_set.merged, workspace.clone_grid);
+	} else {
+		node_set.nodes.assign(nodes.begin(), nodes.end());
+	}
+	return node_set;
+}
+
+//------------------------------------------------------------------------------
+VDTesselation::VDTesselation(node_set_t&& node_set, double tolerance,
+                             delaunay_algorithm_t algorithm, int checks,
+                             bool on_error_display_nodes,
+                             unsigned int num_threads,
+                             TesselationWorkspace* workspace)
+    : N(node_set.borrowed ? node_set.borrowed->size()
+                          : node_set.nodes.size()),
+      tolerance(tolerance), num_threads(thread_count(num_threads)),
+      keep_buffers(workspace != nullptr), constructed(false),
+      cache_state(0), node_storage(std::move(node_set.nodes)),
+      nodes(node_set.borrowed ? *node_set.borrowed : node_storage),
+      merged_nodes_(std::move(node_set.merged)), statistics_()
+{
+	/* Build into the buffers of the workspace: */
+	if (workspace){
+		swap_buffers(*workspace);
+	}
+
 	/* Special cases: N <= 3: */
 	if (N <= 3){
 		if (N == 0)
@@ -211,77 +355,173 @@ VDTesselation::VDTesselation(const std::vector<Node>& nodes,
 			 * links are between just two Voronoi nodes.
 			 * Thus, we do not define the Voronoi network's links. */
 			tesselation_N3(nodes[0], nodes[1], nodes[2], delaunay_triangles_,
-			               delaunay2voronoi, voronoi2delaunay, delaunay_links,
-			               dual_link_delaunay2voronoi, voronoi_nodes,
+			               delaunay2voronoi, voronoi2delaunay, delaunay_links_,
+			               dual_link_delaunay2voronoi, voronoi_nodes_,
 			               voronoi_areas);
 		}
 		/* All caches have been set up: */
 		cache_state = ALL_CACHED;
 	} else {
+		/* Merged nodes contain no duplicates, so that only unmerged
+		 * nodes are checked, by the triangulation algorithm: */
 		try {
-			if (algorithm == FORTUNES){
-				/* Do Fortune's algorithm: */
-				delaunay_triangulation_sphere(nodes, delaunay_triangles_,
-				                              tolerance);
-
-			} else if (algorithm == BRUTE_FORCE) {
-				/* Do a brute force algorithm: */
-				std::cout << "WARNING :\nBRUTE_FORCE algorithm is probably "
-				             "broken on lattices that have more than three "
-				             "nodes on a circumcircle (e.g. regular lattices)"
-				             ".\n";
-				delaunay_triangulation_brute_force(nodes, delaunay_triangles_,
-				                                   tolerance);
+			triangulate(algorithm, checks, workspace,
+			            merged_nodes_.empty());
+		} catch (const std::runtime_error& e){
+			/* If requested, the incremental hull, which decides all
+			 * cases by exact predicates, takes over from a failed sweep.
+			 * The failed run has checked for duplicates: */
+			std::string error(e.what());
+			bool recovered = false;
+			if (algorithm == FORTUNES && (checks & RETRY_INCREMENTAL_HULL)){
+				reset_caches();
+				try {
+					triangulate(INCREMENTAL_HULL, checks, workspace, false);
+					statistics_.fallback = true;
+					recovered = true;
+				} catch (const std::runtime_error& e_retry){
+					error.append("\"\n\nRetry with INCREMENTAL_HULL failed as "
+					             "well:\n\"").append(e_retry.what());
+				}
 			}
+			if (!recovered){
+				/* Add a little hint to the error message: */
+				if (on_error_display_nodes){
+					std::cerr << "ERROR in VDTesselation().\nNode set that "
+					             "caused the error:\n";
+					std::cerr.precision(std::numeric_limits<double>::digits10);
+					for (const Node& n : nodes){
+						std::cerr << "\t(" << n.lon << "," << n.lat << ")\n";
+					}
+					std::cerr << "\n";
+				}
 
-			/* Consistency checks: */
-
-			if (checks & CHECK_DUAL_LINKS){
-				/* If the Delaunay triangulation is inconsistent in a way that
-				 * not for every link a dual link of the Voronoi tesselation can
-				 * be found, this will raise an exception: */
-				calculate_dual_links();
+				throw std::runtime_error("VDTesselation failed:\n\""
+				                         + error +
+				                         "\"\n\nHint: Changing tolerance "
+				                         "or inverting the latitude "
+				                         "coordinates may solve the problems "
+				                         "encountered.\n");
 			}
+		}
+	}
 
-			if (checks & CHECK_VORONOI_CELL_AREAS){
-				/* Calculate Voronoi areas: */
-				calculate_voronoi_cell_areas();
+	/* The nodes have been kept for a retry until now: */
+	constructed = true;
+	tidy_up_cache();
+}
 
-				/* Add up the cell areas: */
-				double sum = 0.0;
-				for (double d : voronoi_areas){
-					sum += d;
-				}
+//------------------------------------------------------------------------------
+void VDTesselation::triangulate(delaunay_algorithm_t algorithm, int checks,
+                                TesselationWorkspace* workspace,
+                                bool check_duplicates)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	if (workspace && check_duplicates){
+		/* Check with the buffers of the workspace instead of letting
+		 * the algorithm allocate its own: */
+		ensure_no_cloned_nodes(nodes, tolerance, "VDTesselation()",
+		                       workspace->clone_grid);
+		check_duplicates = false;
+	}
+	if (algorithm == FORTUNES){
+		/* Do Fortune's algorithm: */
+		sweep_statistics_t sweep;
+		delaunay_triangulation_sphere(nodes, delaunay_triangles_,
+		                              tolerance, &sweep,
+		                              workspace ? &workspace->sweep
+		                                        : nullptr,
+		                              num_threads, check_duplicates);
+		statistics_.peak_beach_size = sweep.peak_beach_size;
+		statistics_.circle_events_pushed
+		    = sweep.circle_events_pushed;
+		statistics_.circle_events_invalidated
+		    = sweep.circle_events_invalidated;
+		statistics_.circle_events_processed
+		    = sweep.circle_events_processed;
+
+	} else if (algorithm == BRUTE_FORCE) {
+		/* Do a brute force algorithm: */
+		std::cout << "WARNING :\nBRUTE_FORCE algorithm is probably "
+		             "broken on lattices that have more than three "
+		             "nodes on a circumcircle (e.g. regular lattices)"
+		             ".\n";
+		delaunay_triangulation_brute_force(nodes, delaunay_triangles_,
+		                                   tolerance);
+	} else if (algorithm == INCREMENTAL_HULL) {
+		/* Do the incremental convex hull algorithm: */
+		delaunay_triangulation_hull(nodes, delaunay_triangles_,
+		                            tolerance, num_threads,
+		                            check_duplicates);
+	} else if (algorithm == DIVIDE_AND_CONQUER) {
+		/* Do the multi-threaded divide-and-conquer algorithm: */
+		delaunay_triangulation_parallel(nodes, delaunay_triangles_,
+		                                tolerance, num_threads,
+		                                check_duplicates);
+	}
+	statistics_.time_triangulation = seconds_since(t0);
 
-				/* Throw exception if we're more than 10*N times further away
-				 * from 4pi than tolerance: */
-				if (std::abs(sum - 4*M_PI) > 10.0*N*tolerance){
-					throw std::runtime_error("Sum of Voronoi areas (" +
-					                    std::to_string(sum) + ") is more than "
-					                    "10*N times farther than tolerance "
-					                    "away from 4pi=" +
-					                    std::to_string(4*M_PI) + "!");
-				}
-			}
-		} catch (const std::runtime_error& e){
-			/* Add a little hint to the error message: */
-			if (on_error_display_nodes){
-				std::cerr << "ERROR in VDTesselation().\nNode set that caused "
-				             "the error:\n";
-				std::cerr.precision(std::numeric_limits<double>::digits10);
-				for (const Node& n : nodes){
-					std::cerr << "\t(" << n.lon << "," << n.lat << ")\n";
-				}
-				std::cerr << "\n";
-			}
+	/* Consistency checks: */
+	t0 = std::chrono::steady_clock::now();
+
+	if (checks & CHECK_TOPOLOGY){
+		/* Verify the triangulation's topology in linear time: */
+		check_topology();
+	}
+
+	if (checks & CHECK_DUAL_LINKS){
+		/* If the Delaunay triangulation is inconsistent in a way that
+		 * not for every link a dual link of the Voronoi tesselation can
+		 * be found, this will raise an exception: */
+		calculate_dual_links();
+	}
+
+	if (checks & CHECK_VORONOI_CELL_AREAS){
+		/* Calculate Voronoi areas: */
+		calculate_voronoi_cell_areas();
 
-			throw std::runtime_error("VDTesselation failed:\n\""
-			                         + std::string(e.what()) +
-			                         "\"\n\nHint: Changing tolerance "
-			                         "or inverting the latitude coordinates "
-			                         "may solve the problems encountered.\n");
+		/* Add up the cell areas: */
+		double sum = 0.0;
+		for (double d : voronoi_areas){
+			sum += d;
+		}
+
+		/* Throw exception if we're more than 10*N times further away
+		 * from 4pi than tolerance: */
+		if (std::abs(sum - 4*M_PI) > 10.0*N*tolerance){
+			throw std::runtime_error("Sum of Voronoi areas (" +
+			                    std::to_string(sum) + ") is more than "
+			                    "10*N times farther than tolerance "
+			                    "away from 4pi=" +
+			                    std::to_string(4*M_PI) + "!");
 		}
 	}
+	statistics_.time_checks = seconds_since(t0);
+}
+
+//------------------------------------------------------------------------------
+void VDTesselation::reset_caches()
+{
+	/* Discard all results of a failed triangulation, keeping the
+	 * capacity: */
+	cache_state = 0;
+	delaunay_triangles_.clear();
+	delaunay2voronoi.clear();
+	voronoi2delaunay.clear();
+	node2delaunay.clear();
+	delaunay_links_.clear();
+	dual_link_delaunay2voronoi.clear();
+	half_edges.clear();
+	voronoi_link_of_edge.clear();
+	voronoi_nodes_.clear();
+	voronoi_links_.clear();
+	voronoi_areas.clear();
+}
+
+//------------------------------------------------------------------------------
+const std::vector<size_t>& VDTesselation::merged_nodes() const
+{
+	return merged_nodes_;
 }
 
 //------------------------------------------------------------------------------
@@ -293,13 +533,29 @@ size_t VDTesselation::size() const
 
 //-----------------------------------------------------------------------------
 void VDTesselation::delaunay_triangulation(std::vector<Link>& links)
-	const
+	const &
 {
 	/* Make sure Delaunay links are cached: */
 	calculate_delaunay_links();
 	
 	/* Copy cache: */
-	links = delaunay_links;
+	links = delaunay_links_;
+}
+
+//------------------------------------------------------------------------------
+void VDTesselation::delaunay_triangulation(std::vector<Link>& links) &&
+{
+	calculate_delaunay_links();
+
+	/* Hand over the cache: */
+	links = std::move(delaunay_links_);
+}
+
+//------------------------------------------------------------------------------
+const std::vector<Link>& VDTesselation::delaunay_links() const
+{
+	calculate_delaunay_links();
+	return delaunay_links_;
 }
 
 //------------------------------------------------------------------------------
@@ -311,19 +567,44 @@ const std::vector<Triangle>& VDTesselation::delaunay_triangles() const
 
 //------------------------------------------------------------------------------
 void VDTesselation::voronoi_tesselation(std::vector<Node>& nodes,
-	std::vector<Link>& links) const
+	std::vector<Link>& links) const &
 {
 	/* Make sure Voronoi network is cached: */
 	calculate_voronoi_network();
 	
 	/* Copy cache: */
-	nodes = voronoi_nodes;
-	links = voronoi_links;
+	nodes = voronoi_nodes_;
+	links = voronoi_links_;
+}
+
+//------------------------------------------------------------------------------
+void VDTesselation::voronoi_tesselation(std::vector<Node>& nodes,
+	std::vector<Link>& links) &&
+{
+	calculate_voronoi_network();
+
+	/* Hand over the cache: */
+	nodes = std::move(voronoi_nodes_);
+	links = std::move(voronoi_links_);
 }
 
+//------------------------------------------------------------------------------
+const std::vector<Node>& VDTesselation::voronoi_nodes() const
+{
+	calculate_voronoi_network();
+	return voronoi_nodes_;
+}
 
 //------------------------------------------------------------------------------
-void VDTesselation::voronoi_cell_areas(std::vector<double>& areas) const
+const std::vector<Link>& VDTesselation::voronoi_links() const
+{
+	calculate_voronoi_network();
+	return voronoi_links_;
+}
+
+
+//------------------------------------------------------------------------------
+void VDTesselation::voronoi_cell_areas(std::vector<double>& areas) const &
 {
 	/* Make sure Voronoi areas are cached: */
 	calculate_voronoi_cell_areas();
@@ -332,39 +613,94 @@ void VDTesselation::voronoi_cell_areas(std::vector<double>& areas) const
 	areas = voronoi_areas;
 }
 
+//------------------------------------------------------------------------------
+void VDTesselation::voronoi_cell_areas(std::vector<double>& areas) &&
+{
+	calculate_voronoi_cell_areas();
+
+	/* Hand over the cache: */
+	areas = std::move(voronoi_areas);
+}
+
+//------------------------------------------------------------------------------
+const std::vector<double>& VDTesselation::voronoi_cell_areas() const
+{
+	calculate_voronoi_cell_areas();
+	return voronoi_areas;
+}
+
 
 
 /* ************************** Caching ******************************* */
 
 
 	
-/* Refurbished Link-Class that orders its indices.
- * All links are undirected, so we don't need to count them twice
- * in different order (i,j), (j,i).
- * Instead, order them so that i<j. */
-struct link_t {
-	/* Constructor: */
-	link_t(size_t i, size_t j){
-		if (i < j){
-			this->i = i;
-			this->j = j;
-		} else {
-			this->i = j;
-			this->j = i;
+/* Sorted, unique links (i<j) of a set of triangles of N nodes.
+ * The edges are sorted by a counting sort on their smaller index and
+ * then within the few edges of each node.
+ * If oriented, only the edges leading from the smaller to the larger
+ * index are used. In a closed triangulation whose triangles are
+ * oriented alike, these are all edges, each exactly once. */
+static void sorted_unique_links(const std::vector<Triangle>& triangles,
+                                size_t N, bool oriented,
+                                std::vector<Link>& links,
+                                unsigned int num_threads)
+{
+	std::vector<size_t> offset(N+1, 0);
+	for (const Triangle& t : triangles){
+		const size_t v[3] = {t.i, t.j, t.k};
+		for (int k=0; k<3; ++k){
+			const size_t a = v[k];
+			const size_t b = v[(k+1) % 3];
+			if (a < b){
+				++offset[a+1];
+			} else if (!oriented){
+				++offset[b+1];
+			}
 		}
 	}
-	
-	/* Comparator: */
-	bool operator<(const link_t& other) const {
-		if (i == other.i){
-			return j < other.j;
+	for (size_t i=0; i<N; ++i){
+		offset[i+1] += offset[i];
+	}
+
+	links.resize(offset[N]);
+	std::vector<size_t> position(offset.begin(), offset.end()-1);
+	for (const Triangle& t : triangles){
+		const size_t v[3] = {t.i, t.j, t.k};
+		for (int k=0; k<3; ++k){
+			const size_t a = v[k];
+			const size_t b = v[(k+1) % 3];
+			if (a < b){
+				links[position[a]++] = Link(a, b);
+			} else if (!oriented){
+				links[position[b]++] = Link(b, a);
+			}
 		}
-		return i < other.i;
 	}
-	
-	/* Members: */
-	size_t i, j;
-};
+	position.clear();
+
+	/* Sort each node's links and remove duplicates. The buckets of the
+	 * nodes are independent, so this is done in parallel: */
+	std::vector<size_t> unique(N);
+	parallel_chunks(N, num_threads,
+	    [&](unsigned int, size_t begin, size_t end){
+		for (size_t i=begin; i<end; ++i){
+			auto first = links.begin() + offset[i];
+			auto last = links.begin() + offset[i+1];
+			std::sort(first, last);
+			unique[i] = std::unique(first, last) - first;
+		}
+	});
+
+	/* Close the gaps left by the duplicates: */
+	size_t n = 0;
+	for (size_t i=0; i<N; ++i){
+		for (size_t k=offset[i]; k<offset[i]+unique[i]; ++k){
+			links[n++] = links[k];
+		}
+	}
+	links.resize(n);
+}
 
 
 
@@ -374,24 +710,28 @@ void VDTesselation::calculate_delaunay_links() const
 	/* Check if we've previously calculated the Delaunay links: */
 	if (cache_state & DELAUNAY_LINKS_CACHED)
 		return;
-	
-	/* We use a set to order the Delaunay links by their indices.
-	 * This will also make sure that links are added only once (all
-	 * links of the Delaunay triangulation are undirected, so we need
-	 * only one of each pair (i,j) and (j,i)) */
-	std::set<link_t> links;
-	
-	for (const Triangle& t : delaunay_triangles_){
-		links.insert(link_t(t.i, t.j));
-		links.insert(link_t(t.i, t.k));
-		links.insert(link_t(t.j, t.k));
-	}
 
-	delaunay_links.reserve(links.size());
-	for (const link_t& l : links){
-		delaunay_links.emplace_back(l.i, l.j);
+	std::lock_guard<std::recursive_mutex> lock(cache_mutex);
+	if (cache_state & DELAUNAY_LINKS_CACHED)
+		return;
+
+	auto t0 = std::chrono::steady_clock::now();
+	
+	/* The Delaunay links are sorted by their indices and each link is
+	 * contained only once (all links of the Delaunay triangulation are
+	 * undirected, so we need only one of each pair (i,j) and (j,i)).
+	 * A closed triangulation of M triangles has 3M/2 links. If the
+	 * oriented edges do not yield these, use all edges: */
+	sorted_unique_links(delaunay_triangles_, N, true, delaunay_links_,
+	                    cache_threads(N));
+	if (2*delaunay_links_.size() != 3*delaunay_triangles_.size()){
+		sorted_unique_links(delaunay_triangles_, N, false, delaunay_links_,
+		                    cache_threads(N));
+		delaunay_links_.shrink_to_fit();
 	}
 	
+	statistics_.time_delaunay_links = seconds_since(t0);
+
 	/* Update cache state: */
 	cache_state |= DELAUNAY_LINKS_CACHED;
 	tidy_up_cache();
@@ -399,81 +739,80 @@ void VDTesselation::calculate_delaunay_links() const
 
 
 
+//------------------------------------------------------------------------------
+static size_t cluster_root(std::vector<size_t>& parent, size_t i)
+{
+	/* Find the root of a union-find tree, halving the path: */
+	while (parent[i] != i){
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
 //------------------------------------------------------------------------------
 void VDTesselation::merge_clusters() const
 {
 	const size_t M = delaunay_triangles_.size();
 
-	/* First, an injective map: */
-	delaunay2voronoi.resize(M);
+	/* Coincident Voronoi nodes stem from cocircular nodes of the
+	 * Delaunay triangulation. The triangles spanned by a set of
+	 * cocircular nodes are connected by edges, so that it suffices to
+	 * compare the Voronoi nodes of the two triangles adjacent to each
+	 * Delaunay edge. Clusters are labelled by union-find, rooted at
+	 * their smallest triangle index: */
+	calculate_half_edges();
+	std::vector<size_t>& parent = delaunay2voronoi;
+	parent.resize(M);
 	for (size_t i=0; i<M; ++i){
-		delaunay2voronoi[i] = i;
+		parent[i] = i;
 	}
-
-	/* Now determine clustered Voronoi nodes (that actually belong to
-	 * the same node): */
-
-	std::vector<Link> cluster_links;
-	geometric_graph_links(voronoi_nodes, cluster_links, tolerance);
-
-	/* Sort the links: */
-	std::sort<std::vector<Link>::iterator>(cluster_links.begin(),
-	                                       cluster_links.end());
-
-
-	/* Now merge clusters. To do this, we iterate over all links
-	 * and set both nodes of each links to the same index (using
-	 * the smaller index).
-	 * Also adjust indices to fill the gaps in the index set. */
-	size_t i_dest = 0;
-	std::vector<bool> adjusted(M, false);
-	std::vector<Node> merged_voronoi_nodes;
-	size_t i_src=0;
-	for (const Link& l : cluster_links){
-		/* All links are given twice, once (i,j) and once (j,i).
-		 * Process only the link where the first index is the smaller
-		 * one: */
-		if (l.i > l.j)
+	for (size_t e=0; e<half_edges.size(); ++e){
+		const size_t f = half_edges.twin(e);
+		if (f < e)
 			continue;
-
-		/* Iterate till we're at position l.i.
-		 * Meanwhile, copy all */
-		for (;i_src<l.i; ++i_src){
-			if (!adjusted[i_src]){
-				delaunay2voronoi[i_src] = i_dest++;
-				merged_voronoi_nodes.push_back(voronoi_nodes[i_src]);
+		const size_t a = HalfEdgeMesh::triangle(e);
+		const size_t b = HalfEdgeMesh::triangle(f);
+		const SphereVector va(voronoi_nodes_[a].lon, voronoi_nodes_[a].lat);
+		const SphereVector vb(voronoi_nodes_[b].lon, voronoi_nodes_[b].lat);
+		if (va.distance(vb) < tolerance){
+			const size_t ra = cluster_root(parent, a);
+			const size_t rb = cluster_root(parent, b);
+			if (ra < rb){
+				parent[rb] = ra;
+			} else if (rb < ra){
+				parent[ra] = rb;
 			}
 		}
+	}
 
-		/* Now proceed depending on whether the index has already
-		 * been processed (that is the case if i<j): */
-		if (!adjusted[i_src]){
-			delaunay2voronoi[i_src] = i_dest++;
-			merged_voronoi_nodes.push_back(voronoi_nodes[i_src]);
-			adjusted[i_src] = true;
-		}
-		delaunay2voronoi[l.j] = delaunay2voronoi[i_src];
-		adjusted[l.j] = true;
-
+	/* Let each triangle point to its root. Parents precede their
+	 * children, so this takes one step per triangle: */
+	for (size_t i=0; i<M; ++i){
+		parent[i] = cluster_root(parent, i);
 	}
 
-	/* Adjust the remainder: */
-	for (;i_src<M; ++i_src){
-		if (!adjusted[i_src]){
-			delaunay2voronoi[i_src] = i_dest++;
-			merged_voronoi_nodes.push_back(voronoi_nodes[i_src]);
+	/* Number the clusters in order of their roots, so that the gaps in
+	 * the index set are filled. A root precedes the other triangles
+	 * of its cluster, so it is numbered first. The parents are
+	 * overwritten by the numbers and the Voronoi nodes compacted in
+	 * place: */
+	size_t clusters = 0;
+	for (size_t i=0; i<M; ++i){
+		if (parent[i] == i){
+			voronoi_nodes_[clusters] = voronoi_nodes_[i];
+			delaunay2voronoi[i] = clusters++;
+		} else {
+			delaunay2voronoi[i] = delaunay2voronoi[parent[i]];
 		}
 	}
 
-	/* Copy reduced Voronoi vector: */
-	voronoi_nodes = merged_voronoi_nodes;
+	/* Keep the reduced Voronoi vector: */
+	voronoi_nodes_.resize(clusters);
 
 	/* Create an inverse map mapping Voronoi nodes to all contributing
 	 * Delaunay triangles (needed for associated nodes): */
-	voronoi2delaunay.resize(voronoi_nodes.size());
-	for (size_t i=0; i<M; ++i){
-		voronoi2delaunay[delaunay2voronoi[i]].push_front(i);
-	}
+	voronoi2delaunay.assign_inverse(delaunay2voronoi, clusters);
 }
 
 
@@ -485,20 +824,34 @@ void VDTesselation::calculate_voronoi_nodes() const
 	/* Check if we've previously calculated the Voronoi nodes: */
 	if (cache_state & VORONOI_NODES_CACHED)
 		return;
+
+	std::lock_guard<std::recursive_mutex> lock(cache_mutex);
+	if (cache_state & VORONOI_NODES_CACHED)
+		return;
 	
 	/* Voronoi nodes are at the circumcenter of the three nodes of the
 	 * Delaunay triangles: */
-	voronoi_nodes.reserve(delaunay_triangles_.size());
-	for (const Triangle& t : delaunay_triangles_){
-		SphereVector vec = SphereVector::circumcenter(
-						SphereVector(nodes[t.i].lon, nodes[t.i].lat),
-						SphereVector(nodes[t.j].lon, nodes[t.j].lat),
-						SphereVector(nodes[t.k].lon, nodes[t.k].lat));
-		voronoi_nodes.emplace_back(vec.lon(), vec.lat());
-	}
+	auto t0 = std::chrono::steady_clock::now();
+	const size_t M = delaunay_triangles_.size();
+	voronoi_nodes_.resize(M);
+	parallel_chunks(M, cache_threads(M),
+	    [&](unsigned int, size_t begin, size_t end){
+		for (size_t m=begin; m<end; ++m){
+			const Triangle& t = delaunay_triangles_[m];
+			SphereVector vec = SphereVector::circumcenter(
+			                SphereVector(nodes[t.i].lon, nodes[t.i].lat),
+			                SphereVector(nodes[t.j].lon, nodes[t.j].lat),
+			                SphereVector(nodes[t.k].lon, nodes[t.k].lat));
+			voronoi_nodes_[m] = Node(vec.lon(), vec.lat());
+		}
+	});
+
+	statistics_.time_voronoi_nodes = seconds_since(t0);
 
 	/* Merge clusters if needed: */
+	t0 = std::chrono::steady_clock::now();
 	merge_clusters();
+	statistics_.time_merge_clusters = seconds_since(t0);
 	
 	/* Cache state: */
 	cache_state |= VORONOI_NODES_CACHED;
@@ -568,13 +921,20 @@ void VDTesselation::calculate_voronoi_network() const
 	if (cache_state & VORONOI_LINKS_CACHED)
 		return;
 
+	std::lock_guard<std::recursive_mutex> lock(cache_mutex);
+	if (cache_state & VORONOI_LINKS_CACHED)
+		return;
+
 	/* First make sure that Voronoi nodes are calculated: */
 	calculate_voronoi_nodes();
 
+	auto t0 = std::chrono::steady_clock::now();
+
 	/* Handle the case that all nodes are concyclic (N>3) seperately: */
-	if (voronoi_nodes.size() == 2){
-		voronoi_network_concyclic(nodes, voronoi_nodes, voronoi_areas,
+	if (voronoi_nodes_.size() == 2){
+		voronoi_network_concyclic(nodes, voronoi_nodes_, voronoi_areas,
 		                          tolerance);
+		statistics_.time_voronoi_network = seconds_since(t0);
 
 		/* Cache state: */
 		cache_state |= (VORONOI_LINKS_CACHED | VORONOI_CELLS_CACHED);
@@ -583,129 +943,78 @@ void VDTesselation::calculate_voronoi_network() const
 		return;
 	}
 
-	/* Init Voronoi cell area vector: */
-	voronoi_areas.resize(nodes.size(), 0.0);
-
-	/* Each Delaunay triangle corresponds to a Voronoi node. In general,
-	 * there will be a constant number of Voronoi nodes per Voronoi cell,
-	 * so that we use indexing by node (of the input network) to generate
-	 * the links of the Delaunay triangulation in linear time.
-	 *
-	 * Here, we reference, by node index, all triangles that node is
-	 * a vertex of.
-	 */
-	std::vector<std::forward_list<size_t>> node2triangle(nodes.size());
-	for (size_t i=0; i<delaunay_triangles_.size(); ++i){
-		node2triangle[delaunay_triangles_[i].i].push_front(i);
-		node2triangle[delaunay_triangles_[i].j].push_front(i);
-		node2triangle[delaunay_triangles_[i].k].push_front(i);
-	}
-
-
-
-	/* Now we iterate over each node index (of the input network) and
-	 * create a closed path, the Voronoi cell: */
-	std::vector<size_t> path;
-
-	struct helper_t {
-		bool   available;
-		size_t id;
-		Triangle t;
-	};
-
-	std::vector<helper_t> local_triangles;
-	for (size_t i=0; i<nodes.size(); ++i){
-		/* Create a local copy of the set of triangles belonging to node
-		 * i: */
-		local_triangles.resize(0);
-		for (size_t t : node2triangle[i]){
-			local_triangles.push_back({true, t, delaunay_triangles_[t]});
-		}
-		node2triangle[i].clear();
-
-		/* Find a closed path: */
-		path.resize(0);
-		path.push_back(local_triangles[0].id);
-		Triangle last = local_triangles[0].t;
-		for (size_t j=1; j<local_triangles.size(); ++j){
-			bool found = false;
-			for (size_t k=1; k<local_triangles.size(); ++k){
-				if (!local_triangles[k].available)
-					continue;
-				if (last.common_border(local_triangles[k].t)){
-					path.push_back(local_triangles[k].id);
-					last = local_triangles[k].t;
-					local_triangles[k].available = false;
-					found = true;
-					break;
-				}
+	/* The Voronoi links are the duals of the Delaunay edges, each of
+	 * which is given by a pair of twin half-edges. If clusters have
+	 * been merged, the dual of an edge inside a cluster is no link, and
+	 * edges may share their dual: */
+	calculate_half_edges();
+	const size_t H = half_edges.size();
+	const bool merged = voronoi_nodes_.size() < delaunay_triangles_.size();
+	std::unordered_map<Link,size_t> vlink2id;
+	voronoi_link_of_edge.assign(H, NO_LINK);
+	for (size_t e=0; e<H; ++e){
+		const size_t f = half_edges.twin(e);
+		if (f < e)
+			continue;
+		size_t l1 = delaunay2voronoi[HalfEdgeMesh::triangle(e)];
+		size_t l2 = delaunay2voronoi[HalfEdgeMesh::triangle(f)];
+		if (l1 == l2)
+			continue;
+		const Link link = (l1 < l2) ? Link(l1, l2) : Link(l2, l1);
+		size_t id = voronoi_links_.size();
+		if (merged){
+			auto ins = vlink2id.emplace(link, id);
+			if (!ins.second){
+				id = ins.first->second;
+			} else {
+				voronoi_links_.push_back(link);
 			}
+		} else {
+			voronoi_links_.push_back(link);
 		}
+		voronoi_link_of_edge[e] = id;
+		voronoi_link_of_edge[f] = id;
+	}
+	vlink2id.clear();
 
-		/* Along this closed path, we can now calculate the cell areas
-		 * of the Voronoi cells using adjacent triangles.
-		 * Also, we can obtain links of the Voronoi tesselation.
-		 * Since each link of the Voronoi tesselation is part of the Voronoi
-		 * cell of two nodes, we will end up with each link being duplicate.*/
-		double area = 0.0;
-		size_t last_i = path[0];
-		SphereVectorEuclid last_vec(voronoi_nodes[delaunay2voronoi[last_i]]);
-		SphereVectorEuclid v_i(nodes[i]);
-		for (size_t j=1; j<path.size(); ++j){
-			size_t next_i = path[j];
-			size_t l1 = delaunay2voronoi[next_i];
-			size_t l2 = delaunay2voronoi[last_i];
-			/* Because each Voronoi cell is a closed path with a fixed rotation,
-			 * the following check should remove any duplicate points from the
-			 * path (because they would be successive nodes). */
-			if (l1 != l2){
-				if (l1 < l2){
-					voronoi_links.emplace_back(l1, l2);
-				} else {
-					voronoi_links.emplace_back(l2, l1);
+	/* The Voronoi cell of a node is bounded by the Voronoi nodes of the
+	 * triangles around it, in the order given by rotating its outgoing
+	 * half-edges. Successive equal Voronoi nodes of merged clusters are
+	 * skipped: */
+	voronoi_areas.resize(nodes.size(), 0.0);
+	parallel_chunks(nodes.size(), cache_threads(nodes.size()),
+	    [&](unsigned int, size_t begin, size_t end){
+		for (size_t i=begin; i<end; ++i){
+			const size_t first = half_edges.outgoing(i);
+			if (first == HalfEdgeMesh::NO_EDGE)
+				continue;
+			double area = 0.0;
+			size_t l0 = delaunay2voronoi[HalfEdgeMesh::triangle(first)];
+			size_t last = l0;
+			SphereVectorEuclid last_vec(voronoi_nodes_[l0]);
+			SphereVectorEuclid v_i(nodes[i]);
+			for (size_t e = half_edges.rotate(first); e != first;
+			     e = half_edges.rotate(e))
+			{
+				size_t l = delaunay2voronoi[HalfEdgeMesh::triangle(e)];
+				if (l != last){
+					SphereVectorEuclid next(voronoi_nodes_[l]);
+					area += SphereVectorEuclid::triangle_area(last_vec,
+					                                          next, v_i);
+					last_vec = next;
+					last = l;
 				}
-				SphereVectorEuclid next(voronoi_nodes[l1]);
-				area += SphereVectorEuclid::triangle_area(last_vec, next,
-				                                          v_i);
-				last_vec = next;
 			}
-			last_i = next_i;
-		}
-
-		size_t l1 = delaunay2voronoi[path[0]];
-		size_t l2 = delaunay2voronoi[last_i];
-		if (l1 != l2){
-			if (l1 < l2){
-				voronoi_links.emplace_back(l1, l2);
-			} else {
-				voronoi_links.emplace_back(l2, l1);
+			if (last != l0){
+				area += SphereVectorEuclid::triangle_area(last_vec, v_i,
+				                    SphereVectorEuclid(voronoi_nodes_[l0]));
 			}
-			area += SphereVectorEuclid::triangle_area(last_vec, v_i,
-			                    SphereVectorEuclid(voronoi_nodes[l1]));
 
+			voronoi_areas[i] = area;
 		}
+	});
 
-		voronoi_areas[i] = area;
-	}
-
-	/* Now we have successfully created the Voronoi tesselation and
-	 * calculated the Voronoi weights. Clean up:
-	 */
-	node2triangle.clear();
-	local_triangles.clear();
-	path.clear();
-
-	/* Finally, we have to sort the Voronoi links... */
-	std::sort<std::vector<Link>::iterator>
-	        (voronoi_links.begin(), voronoi_links.end());
-
-
-	/* ... and remove duplicates! */
-	for (size_t i=1; i<voronoi_links.size()/2; ++i){
-		voronoi_links[i] = voronoi_links[2*i];
-	}
-
-	voronoi_links.resize(voronoi_links.size()/2);
+	statistics_.time_voronoi_network = seconds_since(t0);
 
 	/* Cache state: */
 	cache_state |= (VORONOI_LINKS_CACHED | VORONOI_CELLS_CACHED);
@@ -732,17 +1041,24 @@ void VDTesselation::calculate_dual_links() const
 	if (cache_state & DUAL_LINKS_CACHED)
 		return;
 
+	std::lock_guard<std::recursive_mutex> lock(cache_mutex);
+	if (cache_state & DUAL_LINKS_CACHED)
+		return;
+
 	/* Make sure we have calculated the Delaunay links and the Voronoi
 	 * nodes: */
 	calculate_delaunay_links();
 	calculate_voronoi_network();
 
+	auto t0 = std::chrono::steady_clock::now();
+
 	/* Handle case where all nodes are concyclic: */
-	if (voronoi_nodes.size() == 2){
+	if (voronoi_nodes_.size() == 2){
 		/* Since we cannot define the Voronoi edges in the framework used
 		 * (which allows only at max one unique link between each Voronoi node
 		 *  pair), we have to set the dual mapping to NO_LINK: */
 		dual_link_delaunay2voronoi.resize(delaunay_triangles_.size(), NO_LINK);
+		statistics_.time_dual_links = seconds_since(t0);
 
 		/* Update cache state: */
 		cache_state |= DUAL_LINKS_CACHED;
@@ -751,49 +1067,28 @@ void VDTesselation::calculate_dual_links() const
 		return;
 	}
 
-	/* Create a map mapping all triangles a node is part of by the node's
-	 * index: */
-	std::vector<std::forward_list<size_t>> node2delaunay(N);
-	for (size_t i=0; i<delaunay_triangles_.size(); ++i){
-		const Triangle& t = delaunay_triangles_[i];
-		node2delaunay[t.i].push_front(i);
-		node2delaunay[t.j].push_front(i);
-		node2delaunay[t.k].push_front(i);
-	}
-
-	/* Create a hashtable mapping Voronoi links to their indices in the
-	 * voronoi_links vector: */
-	std::unordered_map<Link,size_t> vlink2id;
-	for (size_t i=0; i<voronoi_links.size(); ++i)
-	{
-		vlink2id.emplace(voronoi_links[i],i);
-	}
-
-	/* Now for each link (l,m) of the Delaunay triangulation find the two
-	 * Delaunay triangles (n,o) which have the edge (l,m).
-	 * (n,o) is the dual edge of (l,m). */
-	dual_link_delaunay2voronoi.resize(delaunay_links.size());
-	for (size_t p=0; p<delaunay_links.size(); ++p)
-	{
-		/* Find the dual link of the Delaunay link: */
-		Link l = dual_link_d2v(delaunay_links[p], node2delaunay);
-
-		/* If we have merged clusters (-> more than 3 cocircular nodes), there
-		 * will be self links. In these cases set invalid index: */
-		if (l.i == l.j){
-			dual_link_delaunay2voronoi[p] = NO_LINK;
-		} else {
-			/* Now we need to find the link's index in
-			 * voronoi_links: */
-			std::unordered_map<Link,size_t>::const_iterator it = vlink2id.find(l);
-			if (it == vlink2id.end())
+	/* The dual link of a Delaunay link is that of its half-edges. If
+	 * clusters have been merged (-> more than 3 cocircular nodes), links
+	 * inside a cluster have no dual link (NO_LINK): */
+	const size_t L = delaunay_links_.size();
+	dual_link_delaunay2voronoi.resize(L);
+	parallel_chunks(L, cache_threads(L),
+	    [&](unsigned int, size_t begin, size_t end){
+		for (size_t p=begin; p<end; ++p)
+		{
+			const Link& l = delaunay_links_[p];
+			size_t e = half_edges.find(l.i, l.j);
+			if (e == HalfEdgeMesh::NO_EDGE)
 				throw std::runtime_error("calculate_dual_links():\nLink ("
-			                             + std::to_string(l.i) + "," +
-			                             std::to_string(l.j) +
-			                             ") not found in set of Voronoi links!");
-			dual_link_delaunay2voronoi[p] = it->second;
+				                         + std::to_string(l.i) + "," +
+				                         std::to_string(l.j) +
+				                         ") not found in set of "
+				                         "half-edges!");
+			dual_link_delaunay2voronoi[p] = voronoi_link_of_edge[e];
 		}
-	}
+	});
+
+	statistics_.time_dual_links = seconds_since(t0);
 
 	/* Update cache state: */
 	cache_state |= DUAL_LINKS_CACHED;
@@ -801,39 +1096,110 @@ void VDTesselation::calculate_dual_links() const
 }
 
 //------------------------------------------------------------------------------
-Link VDTesselation::dual_link_d2v(const Link& link,
-           const std::vector<std::forward_list<size_t> >& node2delaunay) const
+void VDTesselation::calculate_node_triangles() const
 {
-	/* Find the Delaunay triangles which both nodes are part of (should be two):
-	 */
-	size_t tri[2];
-	int k=0;
-	for (size_t i : node2delaunay[link.i]){
-		for (size_t j : node2delaunay[link.j]){
-			if (i == j){
-				tri[k] = i;
-				++k;
-				if (k == 2){
-					/* We found the link. Construct the ordered version: */
-					size_t m = delaunay2voronoi[tri[0]];
-					size_t o = delaunay2voronoi[tri[1]];
-					if (m < o)
-						return Link(m,o);
-					else
-						return Link(o,m);
-				 }
-			}
+	/* Check if we've previously set up the incidence: */
+	if (cache_state & NODE_TRIANGLES_CACHED)
+		return;
+
+	std::lock_guard<std::recursive_mutex> lock(cache_mutex);
+	if (cache_state & NODE_TRIANGLES_CACHED)
+		return;
+
+	node2delaunay.assign_node_triangles(delaunay_triangles_, N);
+
+	/* Cache state: */
+	cache_state |= NODE_TRIANGLES_CACHED;
+}
+
+//------------------------------------------------------------------------------
+void VDTesselation::calculate_half_edges() const
+{
+	/* Check if we've previously set up the half-edges: */
+	if (cache_state & HALF_EDGES_CACHED)
+		return;
+
+	std::lock_guard<std::recursive_mutex> lock(cache_mutex);
+	if (cache_state & HALF_EDGES_CACHED)
+		return;
+
+	calculate_node_triangles();
+	half_edges.assign(delaunay_triangles_, node2delaunay);
+
+	/* Cache state: */
+	cache_state |= HALF_EDGES_CACHED;
+}
+
+
+//------------------------------------------------------------------------------
+void VDTesselation::check_topology() const
+{
+	const size_t M = delaunay_triangles_.size();
+
+	/* Euler characteristic: With E = 3M/2 edges (asserted below by the
+	 * twins), V - E + F = 2 requires M = 2N - 4 triangles: */
+	if (2*M + 8 != 4*N){
+		throw std::runtime_error("ERROR : VDTesselation::check_topology() :"
+		                         "\n" + std::to_string(M) + " triangles do "
+		                         "not match the Euler characteristic of the "
+		                         "sphere for " + std::to_string(N) + " nodes."
+		                         "\n");
+	}
+
+	/* Each half-edge (i,j) needs a twin (j,i) for the triangulation to be
+	 * closed and consistently oriented. This throws otherwise: */
+	calculate_half_edges();
+
+	/* Each node needs to be used, and the triangles around it have to
+	 * form a single fan without repeated edges. Then, each edge is
+	 * shared by exactly two triangles: */
+	std::vector<size_t> visited(N, HalfEdgeMesh::NO_EDGE);
+	for (size_t i=0; i<N; ++i){
+		const size_t first = half_edges.outgoing(i);
+		size_t fan = 0;
+		if (first != HalfEdgeMesh::NO_EDGE){
+			size_t e = first;
+			do {
+				const size_t j = half_edges.target(e);
+				if (visited[j] == i)
+					break;
+				visited[j] = i;
+				++fan;
+				e = half_edges.rotate(e);
+			} while (e != first);
+		}
+		if (fan == 0 || fan != node2delaunay[i].size()){
+			throw std::runtime_error("ERROR : VDTesselation::check_topology()"
+			                         " :\nThe triangles of node "
+			                         + std::to_string(i) + " do not form a "
+			                         "single fan.\n");
 		}
 	}
-	throw std::runtime_error("Dual edge not found!");
-}
 
+	/* Orientation: The signed volume enclosed by the triangles is
+	 * positive if they are oriented counterclockwise seen from outside:
+	 */
+	double volume = 0.0;
+	for (const Triangle& t : delaunay_triangles_){
+		SphereVectorEuclid vi(nodes[t.i]), vj(nodes[t.j]), vk(nodes[t.k]);
+		volume += vi * vj.cross(vk);
+	}
+	if (!(volume > 0.0)){
+		throw std::runtime_error("ERROR : VDTesselation::check_topology() :"
+		                         "\nThe triangles are oriented "
+		                         "clockwise.\n");
+	}
+}
 
 //------------------------------------------------------------------------------
 void VDTesselation::associated_nodes(
 	const std::vector<size_t>& voronoi_nodes,
 	std::vector<size_t>& associated) const
 {
+	/* The map of Voronoi nodes to Delaunay triangles is set up with
+	 * the Voronoi nodes: */
+	calculate_voronoi_nodes();
+
 	/* We iterate over all Voronoi nodes in the given set and mark
 	 * the associated nodes of the original network.
 	 * In the end, we collect all marked nodes. */
@@ -861,20 +1227,99 @@ void VDTesselation::associated_nodes(
 	}
 }
 
+//------------------------------------------------------------------------------
+VDTesselation::statistics_t VDTesselation::statistics() const
+{
+	std::lock_guard<std::recursive_mutex> lock(cache_mutex);
+	statistics_t stats = statistics_;
+
+	/* Memory held by the caches: */
+	stats.bytes_nodes = node_storage.capacity() * sizeof(Node);
+	stats.bytes_delaunay_triangles = delaunay_triangles_.capacity()
+	                                 * sizeof(Triangle);
+	stats.bytes_delaunay_links = delaunay_links_.capacity() * sizeof(Link);
+	stats.bytes_voronoi_nodes = voronoi_nodes_.capacity() * sizeof(Node);
+	stats.bytes_voronoi_links = voronoi_links_.capacity() * sizeof(Link);
+	stats.bytes_voronoi_areas = voronoi_areas.capacity() * sizeof(double);
+	stats.bytes_cluster_maps = delaunay2voronoi.capacity() * sizeof(size_t)
+	                           + voronoi2delaunay.bytes();
+	stats.bytes_dual_links = dual_link_delaunay2voronoi.capacity()
+	                         * sizeof(size_t);
+	stats.bytes_half_edges = half_edges.bytes()
+	    + voronoi_link_of_edge.capacity() * sizeof(size_t);
+	stats.bytes_node_triangles = node2delaunay.bytes();
+
+	return stats;
+}
+
+//------------------------------------------------------------------------------
+unsigned int VDTesselation::cache_threads(size_t n) const
+{
+	/* Spawning threads does not pay off for small loops: */
+	constexpr size_t MIN_ITEMS_PER_THREAD = 10000;
+	return std::max<size_t>(std::min<size_t>(num_threads,
+	                                         n / MIN_ITEMS_PER_THREAD), 1);
+}
+
 //------------------------------------------------------------------------------
 void VDTesselation::tidy_up_cache() const
 {
+	/* The buffers of a workspace are kept until it takes them back,
+	 * and all buffers until the constructor has finished: */
+	if (keep_buffers || !constructed)
+		return;
+
 	/* Check if nodes still need to be stored: */
 	if ((cache_state & VORONOI_NODES_CACHED) &&
 	    (cache_state & VORONOI_CELLS_CACHED))
 	{
-		nodes.clear();
+		std::vector<Node>().swap(node_storage);
+	}
+
+	/* The half-edges are needed only for the Voronoi links and their
+	 * duals: */
+	if ((cache_state & VORONOI_LINKS_CACHED) &&
+	    (cache_state & DUAL_LINKS_CACHED))
+	{
+		half_edges.clear();
+		std::vector<size_t>().swap(voronoi_link_of_edge);
+		cache_state &= ~HALF_EDGES_CACHED;
 	}
 }
 
+//------------------------------------------------------------------------------
+template<typename T>
+static void swap_and_clear(std::vector<T>& a, std::vector<T>& b)
+{
+	a.swap(b);
+	a.clear();
+	b.clear();
+}
+
+//------------------------------------------------------------------------------
+void VDTesselation::swap_buffers(TesselationWorkspace& workspace)
+{
+	swap_and_clear(delaunay_triangles_, workspace.delaunay_triangles);
+	swap_and_clear(delaunay_links_, workspace.delaunay_links);
+	swap_and_clear(voronoi_nodes_, workspace.voronoi_nodes);
+	swap_and_clear(voronoi_links_, workspace.voronoi_links);
+	swap_and_clear(voronoi_areas, workspace.voronoi_areas);
+	swap_and_clear(delaunay2voronoi, workspace.delaunay2voronoi);
+	swap_and_clear(dual_link_delaunay2voronoi, workspace.dual_links);
+	swap_and_clear(voronoi_link_of_edge, workspace.voronoi_link_of_edge);
+
+	/* The incidences and half-edges are overwritten by their assign
+	 * methods: */
+	std::swap(voronoi2delaunay, workspace.voronoi2delaunay);
+	std::swap(node2delaunay, workspace.node2delaunay);
+	std::swap(half_edges, workspace.half_edges);
+}
+
 //------------------------------------------------------------------------------
 void VDTesselation::print_debug(bool sort_triangles) const
 {
+	std::lock_guard<std::recursive_mutex> lock(cache_mutex);
+
 	/* First print Delaunay tesselation: */
 	std::cout << "--- VDTesselation debug output ---\n\nDelaunay tesselation:";
 	size_t column = 0;
@@ -938,8 +1383,8 @@ void VDTesselation::print_debug(bool sort_triangles) const
 				std::cout << "\n  ";
 			}
 
-			std::cout << " [" << 180.0/M_PI*voronoi_nodes[index_map[i]].lon
-			          << ","  << 180.0/M_PI*voronoi_nodes[index_map[i]].lat
+			std::cout << " [" << 180.0/M_PI*voronoi_nodes_[index_map[i]].lon
+			          << ","  << 180.0/M_PI*voronoi_nodes_[index_map[i]].lat
 			          << "]";
 			if (i != M-1){
 				std::cout << ",";
@@ -29,12 +29,16 @@
 #define ACOSA_VDTESSELATION_H
 
 #include <vector>
-#include <forward_list>
+#include <atomic>
+#include <mutex>
 #include <basic_types.hpp>
+#include <halfedge.hpp>
+#include <incidence.hpp>
 
 namespace ACOSA {
 
 class AlphaSpectrum;
+class TesselationWorkspace;
 
 /*!
  * \brief A class representing both the Delaunay- and Voronoi-
@@ -43,11 +47,14 @@ class AlphaSpectrum;
  * This class represents the tesselation of a fixed set of nodes and is,
  * as such, immutably tied to the originally given set.
  * 
- * This class is not (yet?) thread safe.
+ * All const methods may be called concurrently. The lazily computed
+ * caches are filled once, by the first thread that needs them, and are
+ * read without locking afterwards.
  */
 class VDTesselation {
 
 	friend class AlphaSpectrum;
+	friend class TesselationWorkspace;
 
 	public:
 		/*! \brief An enumeration of algorithms available to calculate
@@ -56,6 +63,9 @@ class VDTesselation {
 			/*! \brief The fortune's sweepline algorithms adapted for
 			 *         spherical geometries from [1].
 			 *         Its complexity is O(N*log(N))
+			 *
+			 * See RETRY_INCREMENTAL_HULL to compute the tesselation
+			 * by the INCREMENTAL_HULL algorithm if the sweep fails.
 			 */
 			FORTUNES,
 			/*! \brief An explicit algorithms that tests triples of
@@ -68,10 +78,93 @@ class VDTesselation {
 			 * lattices that have more than 3 nodes on any circumcircle (e.g.
 			 * regular lattices).
 			 */
-			BRUTE_FORCE
+			BRUTE_FORCE,
+			/*! \brief A randomized incremental construction of the convex
+			 *         hull of the nodes' unit vectors, whose faces are the
+			 *         Delaunay triangles.
+			 *         Its expected complexity is O(N*log(N)).
+			 */
+			INCREMENTAL_HULL,
+			/*! \brief A multi-threaded divide-and-conquer algorithm that
+			 *         triangulates overlapping patches of the sphere with
+			 *         the INCREMENTAL_HULL algorithm and joins them.
+			 *         The triangles are the same as those of the serial
+			 *         algorithms, in an order that does not depend on the
+			 *         number of threads.
+			 */
+			DIVIDE_AND_CONQUER
 		};
 
 
+		/*!
+		 * \brief Statistics of the computation of the tesselation.
+		 *
+		 * Wall times are given in seconds. Each phase is timed without
+		 * the phases it depends on, so that the times of the phases
+		 * add up. The checks' time includes all phases computed during
+		 * the checks.
+		 */
+		struct statistics_t {
+			/*! \brief Time of the Delaunay triangulation. */
+			double time_triangulation;
+			/*! \brief Time of the consistency checks in the
+			 *         constructor. */
+			double time_checks;
+			/*! \brief Time to set up the Delaunay links. */
+			double time_delaunay_links;
+			/*! \brief Time to compute the Voronoi nodes without the
+			 *         cluster merge. */
+			double time_voronoi_nodes;
+			/*! \brief Time of the cluster merge of Voronoi nodes. */
+			double time_merge_clusters;
+			/*! \brief Time to compute the Voronoi links and cells. */
+			double time_voronoi_network;
+			/*! \brief Time to compute the dual links. */
+			double time_dual_links;
+
+			/*! \brief Maximum number of arcs in the beach of the
+			 *         FORTUNES algorithm. Zero for other algorithms. */
+			size_t peak_beach_size;
+			/*! \brief Circle events added to the queue by the
+			 *         FORTUNES algorithm. */
+			size_t circle_events_pushed;
+			/*! \brief Circle events removed or replaced before being
+			 *         reached by the sweep. */
+			size_t circle_events_invalidated;
+			/*! \brief Circle events processed by the sweep. */
+			size_t circle_events_processed;
+			/*! \brief Whether the FORTUNES algorithm failed, so that
+			 *         the triangulation was computed by the
+			 *         INCREMENTAL_HULL algorithm instead (see
+			 *         RETRY_INCREMENTAL_HULL). The sweep statistics are
+			 *         those of the failed sweep. */
+			bool fallback;
+
+			/*! \brief Bytes held by the input node copy. */
+			size_t bytes_nodes;
+			/*! \brief Bytes held by the Delaunay triangles. */
+			size_t bytes_delaunay_triangles;
+			/*! \brief Bytes held by the Delaunay links. */
+			size_t bytes_delaunay_links;
+			/*! \brief Bytes held by the Voronoi nodes. */
+			size_t bytes_voronoi_nodes;
+			/*! \brief Bytes held by the Voronoi links. */
+			size_t bytes_voronoi_links;
+			/*! \brief Bytes held by the Voronoi cell areas. */
+			size_t bytes_voronoi_areas;
+			/*! \brief Bytes held by the maps between Delaunay triangles
+			 *         and Voronoi nodes. */
+			size_t bytes_cluster_maps;
+			/*! \brief Bytes held by the dual link map. */
+			size_t bytes_dual_links;
+			/*! \brief Bytes held by the half-edges of the Delaunay
+			 *         triangulation. */
+			size_t bytes_half_edges;
+			/*! \brief Bytes held by the map from nodes to their
+			 *         Delaunay triangles. */
+			size_t bytes_node_triangles;
+		};
+
 		/*!
 		 * \brief Do no consisteny check.
 		 */
@@ -91,6 +184,30 @@ class VDTesselation {
 			 */
 		constexpr static int CHECK_VORONOI_CELL_AREAS = 2;
 
+		/*! \brief Check that the Delaunay triangles form a closed,
+		 *         consistently oriented triangulation of the sphere:
+		 *         Each edge is shared by exactly two triangles in
+		 *         opposite direction, the triangles around each node
+		 *         form a single fan, all nodes are used, the Euler
+		 *         characteristic V - E + F is 2, and the triangles are
+		 *         oriented counterclockwise seen from outside.
+		 *
+		 * Complexity is N. The half-edges set up by the check are
+		 * reused by the Voronoi tesselation.
+		 */
+		constexpr static int CHECK_TOPOLOGY = 4;
+
+		/*! \brief If the FORTUNES algorithm or one of the checks after
+		 *         it fails, compute the tesselation again by the
+		 *         INCREMENTAL_HULL algorithm before throwing.
+		 *
+		 * The retry costs a second triangulation and may hide errors
+		 * of the sweep, so that it is not done by default. It is
+		 * recorded in statistics_t::fallback. If the retry fails as
+		 * well, the error message contains both errors.
+		 */
+		constexpr static int RETRY_INCREMENTAL_HULL = 8;
+
 
 
 		/* The number of nodes of the original network: */
@@ -115,11 +232,20 @@ class VDTesselation {
 		 *                  resistant to lower tolerance
 		 * \param checks Determines which checks to do after the Delaunay
 		 *               triangulation has been created.
-		 *               Default: CHECK_DUAL_LINKS | CHECK_VORONOI_CELL_AREAS
+		 *               Default: CHECK_TOPOLOGY
 		 * \param on_error_display_nodes If check fails, the node coordinates
 		 *                               are written to std::cerr if true.
 		 *                               This can be useful for debugging on
 		 *                               randomly generated networks.
+		 * \param num_threads Number of threads used by multi-threaded
+		 *                    algorithms and to compute the caches of
+		 *                    large tesselations. 0 selects the number of
+		 *                    hardware threads. The results do not depend
+		 *                    on the number of threads.
+		 * \param merge_duplicates If true, nodes that are equal within
+		 *                         tolerance are merged before the
+		 *                         tesselation instead of throwing an
+		 *                         std::domain_error. See merged_nodes().
 		 *
 		 * This method executes the O(N*log(N)) sweepline algorithm
 		 * from [1].
@@ -129,8 +255,94 @@ class VDTesselation {
 		VDTesselation(const std::vector<Node>& nodes,
 		              double tolerance = 1e-10,
 		              delaunay_algorithm_t algorithm = FORTUNES,
-					  int checks = CHECK_DUAL_LINKS | CHECK_VORONOI_CELL_AREAS,
-					  bool on_error_display_nodes = true);
+					  int checks = CHECK_TOPOLOGY,
+					  bool on_error_display_nodes = true,
+					  unsigned int num_threads = 0,
+					  bool merge_duplicates = false);
+
+		/*!
+		 * \brief Constructs a Vorono-Delaunay-tesselation object from
+		 *        a set of nodes, taking ownership of the nodes.
+		 *
+		 * Same as the constructor above but moves the nodes into the
+		 * tesselation instead of copying them.
+		 */
+		VDTesselation(std::vector<Node>&& nodes,
+		              double tolerance = 1e-10,
+		              delaunay_algorithm_t algorithm = FORTUNES,
+		              int checks = CHECK_TOPOLOGY,
+		              bool on_error_display_nodes = true,
+		              unsigned int num_threads = 0,
+		              bool merge_duplicates = false);
+
+		/*!
+		 * \brief Constructs a Vorono-Delaunay-tesselation object from
+		 *        a borrowed set of nodes.
+		 * \param nodes Set of input nodes that is neither copied nor
+		 *              modified. The caller has to keep it alive and
+		 *              unchanged as long as the tesselation is used.
+		 *
+		 * Same as the constructor above but without copying the nodes.
+		 * If duplicates are merged, the merged nodes are a copy held
+		 * by the tesselation.
+		 */
+		VDTesselation(const std::vector<Node>* nodes,
+		              double tolerance = 1e-10,
+		              delaunay_algorithm_t algorithm = FORTUNES,
+		              int checks = CHECK_TOPOLOGY,
+		              bool on_error_display_nodes = true,
+		              unsigned int num_threads = 0,
+		              bool merge_duplicates = false);
+
+		/*!
+		 * \brief Constructs a Vorono-Delaunay-tesselation object from
+		 *        a set of nodes in the buffers of a workspace.
+		 * \param workspace Workspace whose buffers are taken over by
+		 *                  the tesselation. They are not released when
+		 *                  the caches are complete but kept until the
+		 *                  tesselation is handed back by
+		 *                  workspace.recycle().
+		 *
+		 * Same as the first constructor but reuses the memory of
+		 * previous builds, which saves the allocations when many
+		 * tesselations are built one after the other. If the
+		 * constructor throws, the buffers are lost and the next build
+		 * allocates them again.
+		 */
+		VDTesselation(const std::vector<Node>& nodes,
+		              TesselationWorkspace& workspace,
+		              double tolerance = 1e-10,
+		              delaunay_algorithm_t algorithm = FORTUNES,
+		              int checks = CHECK_TOPOLOGY,
+		              bool on_error_display_nodes = true,
+		              unsigned int num_threads = 0,
+		              bool merge_duplicates = false);
+
+		/*!
+		 * \brief Tesselations can be neither copied nor moved.
+		 *
+		 * The caches are computed on demand under a mutex, and the
+		 * nodes may be borrowed from the caller or from a workspace.
+		 * Hold a tesselation by pointer to pass it around.
+		 */
+		VDTesselation(const VDTesselation&) = delete;
+		VDTesselation(VDTesselation&&) = delete;
+		VDTesselation& operator=(const VDTesselation&) = delete;
+		VDTesselation& operator=(VDTesselation&&) = delete;
+
+		/*!
+		 * \brief Obtain the map from the nodes given to the constructor
+		 *        to the merged nodes.
+		 * \return Empty if duplicates have not been merged. Otherwise,
+		 *         for each node given to the constructor, the index of
+		 *         the node it has been merged into.
+		 *
+		 * If duplicates have been merged, N is the number of merged
+		 * nodes and all node indices returned by the other methods
+		 * refer to the merged nodes, ordered by their first occurrence
+		 * in the input.
+		 */
+		const std::vector<size_t>& merged_nodes() const;
 
 		/*!
 		 * \brief Obtain the set of links of the Delaunay triangulation.
@@ -143,7 +355,28 @@ class VDTesselation {
 		 * Since the links are undirected, they will be return only once
 		 * with the smaller index being the first index.
 		 */
-		void delaunay_triangulation(std::vector<Link>& links) const;
+		void delaunay_triangulation(std::vector<Link>& links) const &;
+
+		/*!
+		 * \brief Move the set of links of the Delaunay triangulation
+		 *        out of a tesselation that is no longer needed.
+		 * \param links Output array of links of the triangulation.
+		 *
+		 * Same as the const version but hands over the cached array
+		 * instead of copying it, e.g.
+		 * std::move(tesselation).delaunay_triangulation(links).
+		 * Afterwards, the tesselation may only be used for the other
+		 * move-out methods or be destroyed.
+		 */
+		void delaunay_triangulation(std::vector<Link>& links) &&;
+
+		/*!
+		 * \brief Obtain the set of links of the Delaunay triangulation
+		 *        without copying.
+		 * \return Constant reference to the cached links, valid as long
+		 *         as the tesselation. See delaunay_triangulation(links).
+		 */
+		const std::vector<Link>& delaunay_links() const;
 
 		/*!
 		 * \brief Obtain the set of Delaunay triangles.
@@ -169,7 +402,35 @@ class VDTesselation {
 		 * with the smaller index being the first index.
 		 */
 		void voronoi_tesselation(std::vector<Node>& voronoi_nodes,
-		                        std::vector<Link>& voronoi_links) const;
+		                        std::vector<Link>& voronoi_links) const &;
+
+		/*!
+		 * \brief Move the Voronoi tesselation out of a tesselation
+		 *        that is no longer needed.
+		 *
+		 * Same as the const version but hands over the cached arrays
+		 * instead of copying them, e.g.
+		 * std::move(tesselation).voronoi_tesselation(nodes, links).
+		 * Afterwards, the tesselation may only be used for the other
+		 * move-out methods or be destroyed.
+		 */
+		void voronoi_tesselation(std::vector<Node>& voronoi_nodes,
+		                         std::vector<Link>& voronoi_links) &&;
+
+		/*!
+		 * \brief Obtain the Voronoi nodes without copying.
+		 * \return Constant reference to the cached nodes, valid as long
+		 *         as the tesselation. See voronoi_tesselation().
+		 */
+		const std::vector<Node>& voronoi_nodes() const;
+
+		/*!
+		 * \brief Obtain the links of the Voronoi tesselation without
+		 *        copying.
+		 * \return Constant reference to the cached links, valid as long
+		 *         as the tesselation. See voronoi_tesselation().
+		 */
+		const std::vector<Link>& voronoi_links() const;
 		
 		/*!
 		 * \brief Obtain the areas of the Voronoi cells of the original
@@ -178,7 +439,24 @@ class VDTesselation {
 		 *              corresponds to the order of the source node set
 		 *              given in the constructor.
 		 */
-		void voronoi_cell_areas(std::vector<double>& areas) const;
+		void voronoi_cell_areas(std::vector<double>& areas) const &;
+
+		/*!
+		 * \brief Move the areas of the Voronoi cells out of a
+		 *        tesselation that is no longer needed.
+		 *
+		 * Same as the const version but hands over the cached array
+		 * instead of copying it. Afterwards, the tesselation may only
+		 * be used for the other move-out methods or be destroyed.
+		 */
+		void voronoi_cell_areas(std::vector<double>& areas) &&;
+
+		/*!
+		 * \brief Obtain the areas of the Voronoi cells without copying.
+		 * \return Constant reference to the cached areas, valid as long
+		 *         as the tesselation. See voronoi_cell_areas(areas).
+		 */
+		const std::vector<double>& voronoi_cell_areas() const;
 		
 		/*!
 		 * \brief Obtains all nodes of the original network that are
@@ -194,6 +472,14 @@ class VDTesselation {
 		void associated_nodes(const std::vector<size_t>& voronoi_nodes,
 			std::vector<size_t>& associated) const;
 
+		/*!
+		 * \brief Obtain the statistics of the computations done so far.
+		 *
+		 * The times of phases that have not been computed yet are zero.
+		 * The memory of the caches is that held at the time of the call.
+		 */
+		statistics_t statistics() const;
+
 		/*!
 		 * \brief Print a debug output of the current state to standard
 		 *        output.
@@ -201,9 +487,51 @@ class VDTesselation {
 		void print_debug(bool sort_triangles = true) const;
 	
 	private:
+		/* Nodes to tesselate, either owned or borrowed, and, if
+		 * duplicates have been merged, the map from the input nodes to
+		 * them: */
+		struct node_set_t {
+			std::vector<Node> nodes;
+			const std::vector<Node>* borrowed = nullptr;
+			std::vector<size_t> merged;
+		};
+
+		static node_set_t prepare_nodes(const std::vector<Node>& nodes,
+		                                double tolerance,
+		                                bool merge_duplicates);
+
+		static node_set_t prepare_nodes(std::vector<Node>&& nodes,
+		                                double tolerance,
+		                                bool merge_duplicates);
+
+		static node_set_t prepare_nodes(const std::vector<Node>* nodes,
+		                                double tolerance,
+		                                bool merge_duplicates);
+
+		static node_set_t prepare_nodes(const std::vector<Node>& nodes,
+		                                TesselationWorkspace& workspace,
+		                                double tolerance,
+		                                bool merge_duplicates);
+
+		VDTesselation(node_set_t&& node_set, double tolerance,
+		              delaunay_algorithm_t algorithm, int checks,
+		              bool on_error_display_nodes, unsigned int num_threads,
+		              TesselationWorkspace* workspace);
+
 		/* This variable holds the tolerance that has been set: */
 		const double tolerance;
 
+		/* Number of threads used to compute the caches: */
+		const unsigned int num_threads;
+
+		/* Whether the buffers belong to a workspace, so that they are
+		 * kept when the caches are complete: */
+		const bool keep_buffers;
+
+		/* Whether the constructor has finished. Until then, the nodes
+		 * are kept for a retry with another algorithm: */
+		bool constructed;
+
 		/* This variable holds the initial delaunay triangulation
 		 * in form of a list of triangles. */
 		mutable std::vector<Triangle> delaunay_triangles_;
@@ -219,25 +547,48 @@ class VDTesselation {
 		 * Delaunay triangle associated with a Voronoi node.
 		 * This is a map that stores the Delaunay triangles that contribute
 		 * to a Voronoi node. */
-		mutable std::vector<std::forward_list<size_t>> voronoi2delaunay;
+		mutable CSRIncidence voronoi2delaunay;
+
+		/* The Delaunay triangles of each node, shared by the Voronoi
+		 * tesselation and the AlphaSpectrum: */
+		mutable CSRIncidence node2delaunay;
 		
-		/* Cached variables: */
-		mutable unsigned char cache_state;
+		/* Cached variables. Each cache is computed while holding
+		 * cache_mutex, and its bit is set once it is complete, so that
+		 * a set bit allows reading the cache without locking. The
+		 * mutex is recursive since the calculate_* methods depend on
+		 * each other: */
+		mutable std::atomic<unsigned char> cache_state;
+		mutable std::recursive_mutex cache_mutex;
 		
-		/* The original nodes (deleted in case everything else has been
-		 * calculated): */
-		mutable std::vector<Node> nodes;
+		/* The original nodes, unless borrowed (deleted in case
+		 * everything else has been calculated), and a reference to
+		 * the nodes in use: */
+		mutable std::vector<Node> node_storage;
+		const std::vector<Node>& nodes;
+
+		/* Map of the input nodes to the merged nodes: */
+		std::vector<size_t> merged_nodes_;
+
+		/* Statistics. The memory sizes are set when queried: */
+		mutable statistics_t statistics_;
 		
 		/* Delaunay triangulation: */
-		mutable std::vector<Link> delaunay_links;
+		mutable std::vector<Link> delaunay_links_;
 
 		/* Mapping links of the Delaunay triangulation to links of the
 		 * Voronoi tesselation: */
 		mutable std::vector<size_t> dual_link_delaunay2voronoi;
+
+		/* Half-edges of the Delaunay triangulation and the Voronoi
+		 * link dual to each half-edge. Needed until the Voronoi links
+		 * and dual links have been calculated: */
+		mutable HalfEdgeMesh half_edges;
+		mutable std::vector<size_t> voronoi_link_of_edge;
 		
 		/* Voronoi tesselation: */
-		mutable std::vector<Node> voronoi_nodes;
-		mutable std::vector<Link> voronoi_links;
+		mutable std::vector<Node> voronoi_nodes_;
+		mutable std::vector<Link> voronoi_links_;
 		mutable std::vector<double> voronoi_areas;
 		
 		void calculate_delaunay_links() const;
@@ -250,23 +601,31 @@ class VDTesselation {
 
 		void calculate_dual_links() const;
 
-		/*!
-		 * \brief For a link of the Delaunay triangulation, return the dual
-		 *        link of the Voronoi tesselation.
-		 * \param link A link of the Delaunay triangulation.
-		 * \param node2delaunay A vector of lists that for each node of the
-		 *                      original node set contain the Delaunay triangles
-		 *                      it is part of.
-		 * \return The dual link of the Voronoi tesselation, with indices
-		 *         therein.
-		 */
-		Link dual_link_d2v(const Link& link, const
-		                    std::vector<std::forward_list<size_t>>&
-		                        node2delaunay) const;
+		void calculate_node_triangles() const;
+
+		void calculate_half_edges() const;
 
 		void merge_clusters() const;
 		
 		void tidy_up_cache() const;
+
+		/* Compute the Delaunay triangulation and do the checks. The
+		 * duplicate check is skipped for merged nodes: */
+		void triangulate(delaunay_algorithm_t algorithm, int checks,
+		                 TesselationWorkspace* workspace,
+		                 bool check_duplicates);
+
+		/* Discard the results of a failed triangulation: */
+		void reset_caches();
+
+		/* Exchange the buffers of the caches with those of a workspace,
+		 * leaving both empty with their capacity: */
+		void swap_buffers(TesselationWorkspace& workspace);
+
+		void check_topology() const;
+
+		/* Number of threads used by a cache loop over n items: */
+		unsigned int cache_threads(size_t n) const;
 };
 
 
@@ -0,0 +1,65 @@
+/* Workspace to build several tesselations in reused memory. Part of
+ * ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <workspace.hpp>
+#include <vdtesselation.hpp>
+
+#include <mutex>
+#include <stdexcept>
+
+namespace ACOSA {
+
+//----------------------------------------------------------------------
+TesselationWorkspace::TesselationWorkspace()
+{
+}
+
+//----------------------------------------------------------------------
+void TesselationWorkspace::recycle(VDTesselation&& tesselation)
+{
+	if (!tesselation.keep_buffers){
+		throw std::runtime_error("ERROR : TesselationWorkspace::recycle() :"
+		                         "\nThe tesselation has not been built with"
+		                         " a workspace.\n");
+	}
+
+	/* Take back the caches and the node copy. The tesselation is left
+	 * with empty caches: */
+	std::lock_guard<std::recursive_mutex> lock(tesselation.cache_mutex);
+	tesselation.swap_buffers(*this);
+	nodes.swap(tesselation.node_storage);
+	nodes.clear();
+}
+
+//----------------------------------------------------------------------
+size_t TesselationWorkspace::bytes() const
+{
+	return sweep.bytes() + clone_grid.bytes()
+	    + nodes.capacity() * sizeof(Node)
+	    + delaunay_triangles.capacity() * sizeof(Triangle)
+	    + delaunay_links.capacity() * sizeof(Link)
+	    + voronoi_nodes.capacity() * sizeof(Node)
+	    + voronoi_links.capacity() * sizeof(Link)
+	    + voronoi_areas.capacity() * sizeof(double)
+	    + (delaunay2voronoi.capacity() + dual_links.capacity()
+	       + voronoi_link_of_edge.capacity()) * sizeof(size_t)
+	    + voronoi2delaunay.bytes() + node2delaunay.bytes()
+	    + half_edges.bytes();
+}
+
+} // NAMESPACE ACOSA
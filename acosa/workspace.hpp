@@ -0,0 +1,94 @@
+/* Workspace to build several tesselations in reused memory. Part of
+ * ACOSA.
+ * Copyright (C) 2017 Malte Ziebarth
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACOSA_WORKSPACE_HPP
+#define ACOSA_WORKSPACE_HPP
+
+#include <basic_types.hpp>
+#include <fortunes_sphere.hpp>
+#include <geometricgraph.hpp>
+#include <halfedge.hpp>
+#include <incidence.hpp>
+#include <vector>
+
+namespace ACOSA {
+
+class VDTesselation;
+
+/*!
+ * \brief Buffers that are kept between the builds of several
+ *        tesselations, so that repeated builds do not allocate their
+ *        memory from nothing.
+ *
+ * A tesselation constructed with a workspace takes over the buffers
+ * of the workspace and keeps all its caches until it is handed back
+ * by recycle(), e.g.
+ *
+ *     TesselationWorkspace workspace;
+ *     for (const std::vector<Node>& nodes : node_sets){
+ *         VDTesselation tesselation(nodes, workspace);
+ *         ...
+ *         workspace.recycle(std::move(tesselation));
+ *     }
+ *
+ * The next build then reuses the capacity of the recycled one. A
+ * workspace may be used by only one build at a time.
+ */
+class TesselationWorkspace {
+
+	friend class VDTesselation;
+
+	public:
+		TesselationWorkspace();
+
+		/*!
+		 * \brief Take back the buffers of a tesselation built with
+		 *        this workspace.
+		 *
+		 * Afterwards, the tesselation may only be destroyed.
+		 */
+		void recycle(VDTesselation&& tesselation);
+
+		/* Memory held by the workspace: */
+		size_t bytes() const;
+
+	private:
+		/* Buffers of the sweepline algorithm: */
+		SweepWorkspace sweep;
+
+		/* Buffers of the search for duplicate nodes: */
+		CloneGrid clone_grid;
+
+		/* Buffers of the caches of VDTesselation: */
+		std::vector<Node>     nodes;
+		std::vector<Triangle> delaunay_triangles;
+		std::vector<Link>     delaunay_links;
+		std::vector<Node>     voronoi_nodes;
+		std::vector<Link>     voronoi_links;
+		std::vector<double>   voronoi_areas;
+		std::vector<size_t>   delaunay2voronoi;
+		std::vector<size_t>   dual_links;
+		std::vector<size_t>   voronoi_link_of_edge;
+		CSRIncidence          voronoi2delaunay;
+		CSRIncidence          node2delaunay;
+		HalfEdgeMesh          half_edges;
+};
+
+} // NAMESPACE ACOSA
+
+#endif // ACOSA_WORKSPACE_HPP
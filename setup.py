@@ -45,9 +45,17 @@ extensions.append(Extension('acosa',
 	         'acosa/convexhull.cpp',
 	         'acosa/circleevent.cpp',
 	         'acosa/geometricgraph.cpp',
-	         'acosa/alphaspectrum.cpp'],
+	         'acosa/alphaspectrum.cpp',
+	         'acosa/radixsort.cpp',
+	         'acosa/incrementalhull.cpp',
+	         'acosa/divideconquer.cpp',
+	         'acosa/predicates.cpp',
+	         'acosa/halfedge.cpp',
+	         'acosa/incidence.cpp',
+	         'acosa/workspace.cpp'],
 	include_dirs=[np.get_include(),'acosa'],
-	extra_compile_args=['-std=c++14'],
+	extra_compile_args=['-std=c++14', '-pthread'],
+	extra_link_args=['-pthread'],
 	language='c++'))
 
 extensions[0].cython_c_in_temp = False